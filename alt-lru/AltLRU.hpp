@@ -16,6 +16,12 @@ private:
 	size_t max_count; // Maximum cached items count; 0=unlim
 	size_t stored_items; // Current count of stored items for stat and max_count checking with O(1)
 	size_t expire; // Maximum live time for items(in seconds); 0=unlim
+	size_t max_cost; // Maximum summary cost of cached items; 0=unlim
+	size_t stored_cost; // Current summary cost of stored items
+
+	std::function< size_t(const T&) > cost_callback; // Cost of a value; no callback = every item costs 0
+	std::function< bool(const T&) > can_out_callback; // False for values that can't be cached out (yet); no callback = all can
+	std::function< void(const std::string&, const T&) > out_callback; // Called for every item cached out by checkLimits
 
 
 	typename AltLRUType<T>::altlru_map valuemap;
@@ -37,6 +43,10 @@ private:
 	}
 	void cacheOut(const typename  AltLRUType<T>::altlru_map_iter &it);
 
+	inline bool isOverLimits() const {
+		return (max_count>0 && stored_items>max_count) || (max_cost>0 && stored_cost>max_cost);
+	}
+
 public:
 #ifdef ALTLRU_HITINFO
 	size_t stat_cache_hits, stat_cache_miss, stat_cache_get, stat_cache_set, stat_cache_out;
@@ -52,6 +62,38 @@ public:
 		return stored_items;
 	}
 
+	// Cost limit, see setCostCallback. Items are cached out till the summary cost fits
+	inline size_t maxCost() const {
+		return max_cost;
+	}
+	inline void setMaxCost(size_t max_cost) {
+		this->max_cost = max_cost;
+		checkLimits();
+	}
+	inline size_t cost() const {
+		return stored_cost;
+	}
+
+	// Hooks, see the members. Set them before anything is stored
+	inline void setCostCallback(std::function< size_t(const T&) > callback) {
+		cost_callback = callback;
+	}
+	inline void setCanOutCallback(std::function< bool(const T&) > callback) {
+		can_out_callback = callback;
+	}
+	inline void setOutCallback(std::function< void(const std::string&, const T&) > callback) {
+		out_callback = callback;
+	}
+
+	// Value changed its cost (e.g. grew); asks cost_callback again and checks limits
+	void updateCost(const std::string &keyname, const typename AltLRUType<T>::altlru_key_add_id &id=0);
+
+	// Same as 'get' but doesn't change the use order
+	const T *peek(const std::string &keyname, const typename AltLRUType<T>::altlru_key_add_id &id=0) const;
+
+	// 'get' for the most recently used key 'match' returns true for; O(N)
+	const T *getMatching(std::function< bool(const std::string&) > match);
+
 	// Get cache key. 'id' is used to add uniqueness to keyname(if needed) e.g. AltLRU::get("user", 1234);
 	inline const T *get(const std::string &keyname) {
 		return get(keyname, 0);
@@ -83,6 +125,7 @@ template <typename T>
 AltLRU<T>::AltLRU(size_t max_count, size_t expire) {
 	this->max_count = max_count;
 	this->expire = expire;
+	this->max_cost = 0;
 	clear();
 	valuemap.max_load_factor( 3 ); // Set max_load per bucket to 3
 	valuemap.rehash( max_count * 1.1 ); // Cheate count of buckets to hold max_count values
@@ -104,6 +147,7 @@ void AltLRU<T>::clear() {
 	valuelist.clear();
 	valuemap.clear();
 	stored_items=0;
+	stored_cost=0;
 
 #ifdef ALTLRU_HITINFO
 	stat_cache_hits=stat_cache_miss=stat_cache_get=stat_cache_set=stat_cache_out=0;
@@ -113,11 +157,26 @@ void AltLRU<T>::clear() {
 // Check current limits and remove most unused elements to fit limits
 template <typename T>
 void AltLRU<T>::checkLimits() {
-	while( max_count>0 && stored_items>max_count ) {
-		// Max count/size excess, remove most unused entry
-		auto i = valuelist.end();
+	// Walk from the most unused entry up. Entries can_out_callback refuses are skipped, the limits can be exceeded because of them
+	auto i = valuelist.end();
+	while( isOverLimits() && i != valuelist.begin() ) {
 		i--;
-		cacheOut( *i ); // O(1)
+		auto it = *i;
+		if( can_out_callback && !can_out_callback( *(*it).second->getvalue_ref() ) ) {
+			continue;
+		}
+
+		// cacheOut erases i from valuelist, the one after it stays valid
+		auto next = i;
+		next++;
+		const std::string keyname = (*it).first.first;
+		const T value = *(*it).second->getvalue_ref();
+		cacheOut( it ); // O(1)
+		i = next;
+
+		if( out_callback ) {
+			out_callback( keyname, value );
+		}
 	}
 }
 
@@ -188,21 +247,63 @@ void AltLRU<T>::set(const std::string &keyname, const typename AltLRUType<T>::al
 	auto mapinsert = valuemap.insert( make_pair( ipair, nullptr) ); // O(1)
 	auto it = mapinsert.first;
 
+	const size_t cost = cost_callback ? cost_callback(value) : 0;
 	if( mapinsert.second ) {
 		// A new value was inserted
 		(*it).second = new AltLRU_CacheEntry<T>(value, expire);
+		(*it).second->setCost(cost);
 		// Insert iterator to map intry into valuelist
 		valuelist.push_front( it ); // O(1)
 		(*it).second->setListIter( valuelist.begin() );
 		stored_items++;
+		stored_cost += cost;
 		checkLimits();
 	}else{
 		// Found, change values
 		(*it).second->init(value, expire); // Set new values
+		stored_cost += cost - (*it).second->getCost();
+		(*it).second->setCost(cost);
 		valuelist.splice(valuelist.begin(), valuelist, (*it).second->getListIter()); //Move iterator to front of list
 		//Set cacheentry's listiter to new iterator
 		(*it).second->setListIter( valuelist.begin() );
+		checkLimits();
+	}
+}
+
+// Value changed its cost (e.g. grew); asks cost_callback again and checks limits. Use order is not changed
+template <typename T>
+void AltLRU<T>::updateCost(const std::string &keyname, const typename AltLRUType<T>::altlru_key_add_id &id) {
+	auto it = valuemap.find( make_pair(keyname, id) ); // O(1)
+	if( it == valuemap.end() || !cost_callback ) {
+		return;
+	}
+
+	const size_t cost = cost_callback( *(*it).second->getvalue_ref() );
+	stored_cost += cost - (*it).second->getCost();
+	(*it).second->setCost(cost);
+	checkLimits();
+}
+
+// Same as 'get' but doesn't change the use order and doesn't count for stat
+template <typename T>
+const T *AltLRU<T>::peek(const std::string &keyname, const typename AltLRUType<T>::altlru_key_add_id &id) const {
+	auto it = valuemap.find( make_pair(keyname, id) ); // O(1)
+	if( it == valuemap.end() || (*it).second->isExpired() ) {
+		return nullptr;
+	}
+	return (*it).second->getvalue_ref();
+}
+
+// 'get' for the most recently used key 'match' returns true for; O(N)
+template <typename T>
+const T *AltLRU<T>::getMatching(std::function< bool(const std::string&) > match) {
+	for( auto &i : valuelist ) {
+		if( match( (*i).first.first ) ) {
+			const auto key = (*i).first;
+			return get(key.first, key.second);
+		}
 	}
+	return nullptr;
 }
 
 // Same as 'get' for 'remove'
@@ -246,7 +347,7 @@ void AltLRU<T>::cacheRemove(const typename  AltLRUType<T>::altlru_map_iter &it)
 /* cacheout item. for internal use */
 template <typename T>
 void AltLRU<T>::cacheOut(const typename  AltLRUType<T>::altlru_map_iter &it) {
-	// TODO Call a cacheout callback
+	stored_cost -= (*it).second->getCost();
 	cacheRemove(it);
 	stored_items--;
 #ifdef ALTLRU_HITINFO
@@ -12,10 +12,11 @@ class AltLRU_CacheEntry {
 	typename AltLRUType<T>::altlru_list::iterator listiter;
 	T value;
 	size_t exp;
+	size_t cost; // See AltLRU::setCostCallback; 0 without one
 
 public:
 	// Captain: constructor, init things
-	AltLRU_CacheEntry(const T &v, const size_t expires=0) {
+	AltLRU_CacheEntry(const T &v, const size_t expires=0) : cost(0) {
 		init(v, expires);
 	}
 	virtual ~AltLRU_CacheEntry() {}
@@ -47,6 +48,14 @@ public:
 		}
 		return ( static_cast<size_t>(current_seconds) > exp );
 	}
+	inline size_t getCost() const {
+		return cost;
+	}
+
+	inline void setCost(size_t c) {
+		cost = c;
+	}
+
 	// Get the iterator to corresponding item in LRU 'list'
 	inline typename AltLRUType<T>::altlru_list::iterator &getListIter() {
 		return listiter;
@@ -27,15 +27,23 @@ KDirectory::KDirectory(const QString& directory, QObject *parent)
     // I sadly have to catch the signals and re-emit them with the current KDirectory object. I don't know of a better way (yet).
     connect(d, &KDirectoryPrivate::entriesProcessed, [&](){ emit entriesProcessed(this); });
     connect(d, &KDirectoryPrivate::completed, [&](){ emit completed(this); });
-    connect(d, &KDirectoryPrivate::entryDetailsChanged, [&](int id){ emit entryDetailsChanged(this, id); });
+    connect(d, &KDirectoryPrivate::entriesDetailsChanged, [&](const KDirectoryRanges& ranges){ emit entriesDetailsChanged(this, ranges); });
+    connect(d, &KDirectoryPrivate::entriesAdded, [&](const KDirectoryRanges& ranges){ emit entriesAdded(this, ranges); });
+    connect(d, &KDirectoryPrivate::entriesRemoved, [&](const KDirectoryRanges& ranges){ emit entriesRemoved(this, ranges); });
+    connect(d, &KDirectoryPrivate::entriesChanged, [&](const KDirectoryRanges& ranges){ emit entriesChanged(this, ranges); });
 }
 
-const QVector<KDirectoryEntry> &KDirectory::entries()
+const KDirectoryEntryStore &KDirectory::entries()
 {
-    return d->m_filteredEntries;
+    return *d->m_entries;
 }
 
-const KDirectoryEntry &KDirectory::entry(int index)
+int KDirectory::entryIndex(int row)
+{
+    return d->m_rows.value(row, -1);
+}
+
+KDirectoryEntry KDirectory::entry(int index)
 {
     return d->entry(index);
 }
@@ -61,6 +69,26 @@ QDir::Filters KDirectory::filter()
     return d->filter();
 }
 
+void KDirectory::setRecursive(bool recursive)
+{
+    d->m_recursive = recursive;
+}
+
+bool KDirectory::isRecursive()
+{
+    return d->m_recursive;
+}
+
+void KDirectory::setSnapshotsEnabled(bool enabled)
+{
+    d->m_snapshotsEnabled = enabled;
+}
+
+bool KDirectory::snapshotsEnabled()
+{
+    return d->m_snapshotsEnabled;
+}
+
 void KDirectory::setFilter(QDir::Filters filters)
 {
     d->setFilter(filters);
@@ -80,3 +108,89 @@ void KDirectory::loadEntryDetails(int id)
 {
     d->loadEntryDetails(id);
 }
+
+int KDirectory::detailsChangedInterval()
+{
+    return d->m_detailsChangedTimer.interval();
+}
+
+void KDirectory::setDetailsChangedInterval(int msec)
+{
+    d->m_detailsChangedTimer.setInterval(msec);
+}
+
+void KDirectory::ref()
+{
+    d->m_refCount++;
+}
+
+void KDirectory::deref()
+{
+    if(--d->m_refCount > 0) {
+        return;
+    }
+
+    if(d->m_completed) {
+        emit released(this);
+        return;
+    }
+
+    d->cancelListing();
+    emit cancelled(this);
+}
+
+void KDirectory::setDeferredStart(bool deferred)
+{
+    d->m_deferredStart = deferred;
+}
+
+void KDirectory::start()
+{
+    // Always from the event loop, like a normal start. A snapshot would otherwise report it's entries before our caller is connected.
+    QTimer::singleShot(0, d, SLOT(startListing()));
+}
+
+void KDirectory::suspend()
+{
+    d->suspendListing(KDirectoryPrivate::Scheduler);
+}
+
+void KDirectory::resume()
+{
+    d->resumeListing(KDirectoryPrivate::Scheduler);
+}
+
+void KDirectory::reload()
+{
+    d->reload();
+}
+
+bool KDirectory::isReferenced()
+{
+    return d->m_refCount > 0;
+}
+
+qint64 KDirectory::memoryUsage()
+{
+    return d->memoryUsage();
+}
+
+const KDirectoryBatchPolicy &KDirectory::batchPolicy()
+{
+    return d->m_batchPolicy;
+}
+
+void KDirectory::setBatchPolicy(const KDirectoryBatchPolicy &policy)
+{
+    d->m_batchPolicy = policy;
+}
+
+bool KDirectory::isCompleted()
+{
+    return d->m_completed;
+}
+
+void KDirectory::setVisibleRange(int first, int last)
+{
+    d->setVisibleRange(first, last);
+}
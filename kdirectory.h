@@ -22,12 +22,38 @@
 
 #include <QObject>
 #include <QDir>
+#include <QVector>
+#include <QMetaType>
 #include <KIO/Job>
 
 #include "kdirectoryentry.h"
+#include "kdirectoryentrystore.h"
+#include "kdirectorybatchpolicy.h"
 
 class KDirectoryPrivate;
 
+/**
+ * A range of entry indexes. Both first and last are part of the range.
+ */
+struct KDirectoryRange
+{
+    KDirectoryRange(int first = 0, int last = -1)
+        : first(first)
+        , last(last)
+    {
+    }
+
+    int count() const { return last - first + 1; }
+
+    int first;
+    int last;
+};
+
+Q_DECLARE_TYPEINFO(KDirectoryRange, Q_PRIMITIVE_TYPE);
+
+// Ranges are always sorted ascending and never overlap.
+typedef QVector<KDirectoryRange> KDirectoryRanges;
+
 class KDirectory : public QObject
 {
     Q_OBJECT
@@ -35,17 +61,27 @@ public:
     explicit KDirectory(const QString& directory, QObject *parent = 0);
     
     /**
-     * Returns all entries that passed the filters and flags.
-     * @return QVector<KDirectoryEntry>
+     * Returns all entries of this directory, also the ones that don't pass the filters. They are stored in
+     * the order they came in, not in the sorted order. Use entryIndex to get the index in this store of a row,
+     * count() is the number of rows.
+     * @return KDirectoryEntryStore
      */
-    virtual const QVector<KDirectoryEntry>& entries();
+    virtual const KDirectoryEntryStore& entries();
+
+    /**
+     * The index in entries() of the entry that is shown at @p row.
+     * @param row
+     * @return int the index or -1 if the row is unknown.
+     */
+    virtual int entryIndex(int row);
 
     /**
      * Entry returns the KDirectoryEntry object if it's index is in the filteredEntries.
+     * The returned object is a cheap view on the entry store, no data is copied.
      * @param index
-     * @return KDirectoryEntry at index
+     * @return KDirectoryEntry at index or an invalid KDirectoryEntry if the index is unknown.
      */
-    virtual const KDirectoryEntry& entry(int index);
+    virtual KDirectoryEntry entry(int index);
 
     /**
      * String of the full path for this directory.
@@ -61,14 +97,35 @@ public:
 
     /**
      * Set the details for the current directory. It can be 0 (no details) or 2 (full details).
-     * If the value passed is different then the current details value (and valid) then the
-     * directory will be re-scanned according to the new details value.
+     * Going from 0 to 2 after the listing started lists the directory again with details and
+     * fills those in for the entries we have. Names and positions don't change, entriesDetailsChanged
+     * tells which entries got their details.
      * @param QString details. Either 0 or 2.
      * @return KDirectoryEntry at index
      */
     virtual void setDetails(const QString& details);
 
-    // For those, see QDir documentation.
+    /**
+     * List all sub folders too. Entries in sub folders are named by their path relative to this folder
+     * ("sub/file.txt"), see KDirectoryEntryStore::parentPath and KDirectoryEntryStore::parentIndex for
+     * the tree. Local folders are read with a few sub folders at the same time. Set this right after
+     * creating the directory, before the listing starts.
+     * @param bool recursive
+     */
+    void setRecursive(bool recursive);
+    bool isRecursive();
+
+    /**
+     * Keep a snapshot of this (local) directory on disk, see KDirectorySnapshot. When a snapshot exists
+     * it is shown right away and a relist in the background reports what changed since. Set this right
+     * after creating the directory, before the listing starts.
+     * @param bool enabled
+     */
+    void setSnapshotsEnabled(bool enabled);
+    bool snapshotsEnabled();
+
+    // For those, see QDir documentation. A new filter is applied to the entries that are already
+    // listed right away (no new listing), entriesRemoved and entriesAdded tell what changed.
     QDir::Filters filter();
     void setFilter(QDir::Filters filters);
     QDir::SortFlags sorting();
@@ -77,13 +134,95 @@ public:
     /**
      * Loads the entry details and passes it to the KDirectoryEntry that needs the information.
      * Be aware that this function is executing a (slow) stat call!
-     * @param int id the id of the file to load. This is the QVector index id.
+     * @param int id the row of the entry, like entry() takes.
      */
     void loadEntryDetails(int id);
 
+    /**
+     * Tells which entries are on screen. Details for those are loaded first and queued requests
+     * for entries far away from them are dropped when the range moves.
+     * @param int first the first visible index, -1 if unknown.
+     * @param int last the last visible index, -1 if unknown.
+     */
+    void setVisibleRange(int first, int last);
+
+    /**
+     * Loaded details are collected for this many milliseconds and then reported with one
+     * entriesDetailsChanged signal. The default is one frame (16 ms), 0 reports them once
+     * the event loop is idle again.
+     * @return int milliseconds
+     */
+    int detailsChangedInterval();
+    void setDetailsChangedInterval(int msec);
+
+    /**
+     * Users of this directory (models) reference it for as long as they show it. When the last
+     * reference is dropped before the listing is done, the listing is cancelled and cancelled is
+     * emitted. A half listed folder is of no use to anyone.
+     */
+    void ref();
+    void deref();
+
+    /**
+     * Normally the listing starts as soon as the event loop runs, right after the directory is created.
+     * A deferred directory waits for start() instead, see KListingScheduler. Set this right after creating
+     * the directory.
+     * @param bool deferred
+     */
+    void setDeferredStart(bool deferred);
+
+    /**
+     * Starts the listing from the event loop. Does nothing if it was started before.
+     */
+    void start();
+
+    /**
+     * Suspends and resumes the listing, for example to let a more important listing go first. This is
+     * independent of the suspending we do ourselves when entries come in faster then they are processed.
+     */
+    void suspend();
+    void resume();
+
+    /**
+     * Lists the directory again in the background. The current entries stay as they are in the meantime.
+     * Once the new listing is in it is compared with what we have by name, only the differences are reported
+     * (entriesAdded, entriesRemoved and entriesChanged) and completed is emitted again. Does nothing while
+     * the first listing is still running.
+     */
+    void reload();
+
+    /**
+     * Returns true as long as a model (or anyone else) holds a reference, see ref().
+     * @return bool
+     */
+    bool isReferenced();
+
+    /**
+     * Bytes in use by this directory: the entry stores, sort keys and entries waiting to be
+     * processed. This is calculated from the allocated capacity and cheap to call.
+     * @return qint64 bytes
+     */
+    qint64 memoryUsage();
+
+    /**
+     * Returns true once all entries are listed (completed was emitted).
+     * @return bool
+     */
+    bool isCompleted();
+
+    /**
+     * How many listed entries are processed at once (and reported with entriesProcessed). Set this
+     * before the listing starts, right after creating the directory.
+     * The policy also holds the counters of the listing (batch count, average size, time to first batch).
+     * @return KDirectoryBatchPolicy
+     */
+    const KDirectoryBatchPolicy& batchPolicy();
+    void setBatchPolicy(const KDirectoryBatchPolicy& policy);
+
 signals:
     /**
-     * New entries in this folder have been processed.
+     * New entries in this folder have been processed. If the new entries all ended up at the end
+     * this is the only signal, otherwise entriesAdded is emitted first.
      * @param KDirectory* directory pointer to the current directory. This pointer is given
      *        because you're likely to use multiple KDirectory objects so you wouldn't easily
      *        know which KDirectory object spawned this signal.
@@ -99,18 +238,59 @@ signals:
     void completed(KDirectory* dir);
 
     /**
-     * Done loading entries.
+     * The listing was cancelled because nobody uses this directory anymore, see deref.
+     * @param KDirectory* directory pointer to the current directory.
+     */
+    void cancelled(KDirectory* dir);
+
+    /**
+     * The last reference to this (completely listed) directory was dropped, see deref. Nobody
+     * shows it anymore, whoever keeps it around may free it now.
+     * @param KDirectory* directory pointer to the current directory.
+     */
+    void released(KDirectory* dir);
+
+    /**
+     * Details where loaded for entries (see loadEntryDetails). Entries are collected for
+     * detailsChangedInterval and reported together.
      * @param KDirectory* directory pointer to the current directory. This pointer is given
      *        because you're likely to use multiple KDirectory objects so you wouldn't easily
      *        know which KDirectory object spawned this signal.
-     * @param int id is the id that you can use to get the KDirectoryEntry object (entry(id)).
+     * @param KDirectoryRanges ranges the indexes of the entries that have their details now.
+     */
+    void entriesDetailsChanged(KDirectory* dir, const KDirectoryRanges& ranges);
+
+    /**
+     * Entries where added to this folder after it was listed (KDirWatch noticed new files), or
+     * a batch of entries got sorted in between the entries that where already there.
+     * Without sorting new entries are appended. The ranges are the indexes the entries have now,
+     * process them from the first to the last range.
+     * @param KDirectory* directory pointer to the current directory.
+     * @param KDirectoryRanges ranges the indexes of the new entries.
+     */
+    void entriesAdded(KDirectory* dir, const KDirectoryRanges& ranges);
+
+    /**
+     * Entries where removed from this folder. The entries are already gone when this is emitted.
+     * The ranges are the indexes from before the removal. Process them from the last to the first
+     * range, that way the indexes of the ranges still to come stay valid.
+     * @param KDirectory* directory pointer to the current directory.
+     * @param KDirectoryRanges ranges the indexes of the removed entries.
+     */
+    void entriesRemoved(KDirectory* dir, const KDirectoryRanges& ranges);
+
+    /**
+     * Entries changed on disk (size, time, permissions, ...).
+     * @param KDirectory* directory pointer to the current directory.
+     * @param KDirectoryRanges ranges the indexes of the changed entries.
      */
-    void entryDetailsChanged(KDirectory* dir, int id);
+    void entriesChanged(KDirectory* dir, const KDirectoryRanges& ranges);
 
 private:
     KDirectoryPrivate *const d;
 };
 
 Q_DECLARE_TYPEINFO(KDirectory, Q_MOVABLE_TYPE);
+Q_DECLARE_METATYPE(KDirectoryRanges)
 
 #endif // KDIRECTORY_H
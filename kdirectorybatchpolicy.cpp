@@ -0,0 +1,62 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "kdirectorybatchpolicy.h"
+
+KDirectoryBatchPolicy::KDirectoryBatchPolicy(int firstBatchSize, int frameBudget)
+    : m_firstBatchSize(qBound(1, firstBatchSize, int(MaxBatchSize)))
+    , m_frameBudget(qMax(1, frameBudget))
+    , m_batchSize(m_firstBatchSize)
+    , m_batchCount(0)
+    , m_entryCount(0)
+    , m_timeToFirstBatch(-1)
+    , m_timer()
+{
+}
+
+void KDirectoryBatchPolicy::start()
+{
+    m_batchSize = m_firstBatchSize;
+    m_batchCount = 0;
+    m_entryCount = 0;
+    m_timeToFirstBatch = -1;
+    m_timer.start();
+}
+
+void KDirectoryBatchPolicy::batchProcessed(int size, qint64 nsecs)
+{
+    if(m_batchCount == 0 && m_timer.isValid()) {
+        m_timeToFirstBatch = m_timer.elapsed();
+    }
+    m_batchCount++;
+    m_entryCount += size;
+
+    // A batch that wasn't full (the listing couldn't keep up) tells nothing about how much more we could handle.
+    if(size < m_batchSize) {
+        return;
+    }
+
+    const qint64 budget = qint64(m_frameBudget) * 1000000;
+    if(nsecs < budget / 2) {
+        m_batchSize = qMin(m_batchSize * 2, int(MaxBatchSize));
+    } else if(nsecs > budget) {
+        // Scale down to what would have fit in the budget.
+        m_batchSize = qMax(m_firstBatchSize, int(qint64(m_batchSize) * budget / nsecs));
+    }
+}
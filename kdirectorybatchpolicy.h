@@ -0,0 +1,102 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KDIRECTORYBATCHPOLICY_H
+#define KDIRECTORYBATCHPOLICY_H
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+/**
+ * Decides how many listed entries are processed (and reported with entriesProcessed) at once.
+ *
+ * The first batch is small so the first rows show up right away. After that the batch size
+ * follows the time it takes to process a batch: it doubles while a batch takes less then half
+ * of the frame budget and shrinks when a batch takes longer then the budget. That way a big
+ * folder fills the view in as few steps as possible without ever blocking a frame for long.
+ *
+ * The policy also keeps a few counters about the listing, see batchCount(), averageBatchSize()
+ * and timeToFirstBatch().
+ */
+class KDirectoryBatchPolicy
+{
+public:
+    enum { DefaultFirstBatchSize = 64, DefaultFrameBudget = 8, MaxBatchSize = 50000 };
+
+    /**
+     * @param firstBatchSize the number of entries in the first batch.
+     * @param frameBudget the time in milliseconds a batch may take.
+     */
+    explicit KDirectoryBatchPolicy(int firstBatchSize = DefaultFirstBatchSize, int frameBudget = DefaultFrameBudget);
+
+    int firstBatchSize() const { return m_firstBatchSize; }
+    int frameBudget() const { return m_frameBudget; }
+
+    /**
+     * Call this when the listing starts. Resets the counters and the batch size.
+     */
+    void start();
+
+    /**
+     * The number of entries to process in the next batch.
+     * @return int
+     */
+    int batchSize() const { return m_batchSize; }
+
+    /**
+     * Call this after every batch. Updates the counters and the next batch size.
+     * @param size the number of entries in the batch.
+     * @param nsecs the time it took to process the batch in nanoseconds.
+     */
+    void batchProcessed(int size, qint64 nsecs);
+
+    /**
+     * Number of batches processed since start().
+     * @return int
+     */
+    int batchCount() const { return m_batchCount; }
+
+    /**
+     * Number of entries processed since start().
+     * @return qint64
+     */
+    qint64 entryCount() const { return m_entryCount; }
+
+    /**
+     * @return int the average number of entries per batch, 0 if there was no batch yet.
+     */
+    int averageBatchSize() const { return m_batchCount ? int(m_entryCount / m_batchCount) : 0; }
+
+    /**
+     * Time from start() till the first batch was processed.
+     * @return qint64 milliseconds, -1 if there was no batch yet.
+     */
+    qint64 timeToFirstBatch() const { return m_timeToFirstBatch; }
+
+private:
+    int m_firstBatchSize;
+    int m_frameBudget;
+    int m_batchSize;
+    int m_batchCount;
+    qint64 m_entryCount;
+    qint64 m_timeToFirstBatch;
+    QElapsedTimer m_timer;
+};
+
+#endif // KDIRECTORYBATCHPOLICY_H
@@ -0,0 +1,136 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "kdirectorycache_p.h"
+#include "kdirectory.h"
+
+KDirectoryCache::KDirectoryCache(qint64 budget)
+    : m_lru(0)
+    , m_keys()
+    , m_budget(budget)
+    , m_hits(0)
+    , m_misses(0)
+    , m_evictions(0)
+{
+    m_lru.setCostCallback([](KDirectory* const& dir) { return size_t(dir->memoryUsage()); });
+    m_lru.setCanOutCallback([](KDirectory* const& dir) { return canEvict(dir); });
+    m_lru.setOutCallback([this](const std::string&, KDirectory* const& dir) { evicted(dir); });
+    setBudget(budget);
+}
+
+KDirectory *KDirectoryCache::object(const QString &key)
+{
+    KDirectory* const* dir = m_lru.get(key.toStdString());
+    if(!dir) {
+        m_misses++;
+        return 0;
+    }
+
+    m_hits++;
+    return *dir;
+}
+
+KDirectory *KDirectoryCache::objectWithPrefix(const QString &prefix)
+{
+    const std::string stdPrefix = prefix.toStdString();
+    KDirectory* const* dir = m_lru.getMatching([&stdPrefix](const std::string& key) {
+        return key.compare(0, stdPrefix.size(), stdPrefix) == 0;
+    });
+    if(!dir) {
+        m_misses++;
+        return 0;
+    }
+
+    m_hits++;
+    return *dir;
+}
+
+KDirectory *KDirectoryCache::peek(const QString &key) const
+{
+    KDirectory* const* dir = m_lru.peek(key.toStdString());
+    return dir ? *dir : 0;
+}
+
+void KDirectoryCache::insert(const QString &key, KDirectory *dir)
+{
+    KDirectory* oldDir = peek(key);
+    if(oldDir && oldDir != dir) {
+        remove(key);
+    }
+
+    // For the same directory this only marks it as used and updates it's cost.
+    m_keys.insert(dir, key);
+    m_lru.set(key.toStdString(), dir);
+}
+
+void KDirectoryCache::remove(const QString &key)
+{
+    KDirectory* dir = peek(key);
+    if(!dir) {
+        return;
+    }
+
+    m_lru.remove(key.toStdString());
+    m_keys.remove(dir);
+    release(dir);
+}
+
+void KDirectoryCache::updateCost(KDirectory *dir)
+{
+    QHash<KDirectory*, QString>::const_iterator it = m_keys.constFind(dir);
+    if(it == m_keys.constEnd()) {
+        return;
+    }
+
+    m_lru.updateCost(it.value().toStdString());
+}
+
+void KDirectoryCache::trim()
+{
+    m_lru.checkLimits();
+}
+
+void KDirectoryCache::setBudget(qint64 bytes)
+{
+    m_budget = bytes;
+
+    // A max cost of 0 is unlimited for AltLRU, for us it means keeping nothing that can be evicted.
+    m_lru.setMaxCost(size_t(qMax<qint64>(bytes, 1)));
+}
+
+bool KDirectoryCache::canEvict(KDirectory *dir)
+{
+    // A directory that is still being listed is about to be shown by someone, dropping it would waste the listing.
+    return !dir->isReferenced() && dir->isCompleted();
+}
+
+void KDirectoryCache::release(KDirectory *dir)
+{
+    if(!dir->isReferenced()) {
+        // We might be called from within a signal of this directory.
+        dir->deleteLater();
+    }
+}
+
+void KDirectoryCache::evicted(KDirectory *dir)
+{
+    m_keys.remove(dir);
+    release(dir);
+    m_evictions++;
+}
@@ -0,0 +1,130 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KDIRECTORYCACHE_P_H
+#define KDIRECTORYCACHE_P_H
+
+#include <QString>
+#include <QHash>
+
+#include "alt-lru/AltLRU.hpp"
+
+class KDirectory;
+
+/**
+ * Least recently used cache of listed directories, bounded by memory instead of a count.
+ *
+ * This is the bundled AltLRU with it's cost hooks set:
+ * - The cost of a directory is KDirectory::memoryUsage(), which grows while it is being
+ *   listed. Call updateCost() when it changed. The budget is AltLRU's maximum cost.
+ * - Directories that are still shown by a model (KDirectory::isReferenced()) or still being
+ *   listed are never evicted. Those are skipped, the cache can go over budget because of them.
+ * - Evicted directories come back through AltLRU's cache out callback, which releases them.
+ *
+ * Directories are cached under a key, KDirectoryStore uses the url plus how it is listed (see
+ * KDirectoryStore::cacheKey) so one url can be in here several times.
+ *
+ * Evicted and removed directories are deleted (later) if nobody references them. A referenced
+ * directory that is removed stays alive, it's owner has to free it on KDirectory::released.
+ */
+class KDirectoryCache
+{
+public:
+    enum { DefaultBudget = 128 * 1024 * 1024 };
+
+    explicit KDirectoryCache(qint64 budget = DefaultBudget);
+
+    /**
+     * Looks up @p key and marks it as the most recently used directory. Counts as a hit or a miss.
+     * @return KDirectory pointer or 0 if the key isn't cached.
+     */
+    KDirectory* object(const QString& key);
+
+    /**
+     * Like object(), for the most recently used key that starts with @p prefix. This walks the whole
+     * cache, it's meant for the occasional lookup by url only.
+     * @return KDirectory pointer or 0 if no key starts with @p prefix.
+     */
+    KDirectory* objectWithPrefix(const QString& prefix);
+
+    /**
+     * Like object(), but doesn't touch the use order or the counters.
+     * @return KDirectory pointer or 0 if the key isn't cached.
+     */
+    KDirectory* peek(const QString& key) const;
+
+    bool contains(const QString& key) const { return peek(key) != 0; }
+
+    /**
+     * Returns the key @p dir is cached under, a null string if it isn't cached.
+     * @return QString
+     */
+    QString key(KDirectory* dir) const { return m_keys.value(dir); }
+
+    /**
+     * Adds @p dir as the most recently used directory. A directory that was cached under the same
+     * key is removed (see remove()). Other directories might be evicted to stay within budget.
+     */
+    void insert(const QString& key, KDirectory* dir);
+
+    /**
+     * Removes @p key from the cache. The directory is deleted if nobody references it.
+     */
+    void remove(const QString& key);
+
+    /**
+     * Recalculates the cost of @p dir and evicts directories if that puts the cache over budget.
+     * Call this when the directory got new entries or when it isn't referenced anymore.
+     */
+    void updateCost(KDirectory* dir);
+
+    /**
+     * Evicts the least recently used directories till the cache is within budget again.
+     */
+    void trim();
+
+    qint64 budget() const { return m_budget; }
+    void setBudget(qint64 bytes);
+
+    /**
+     * The sum of the costs of all cached directories.
+     * @return qint64 bytes
+     */
+    qint64 memoryUsage() const { return m_lru.cost(); }
+    int count() const { return m_lru.count(); }
+
+    quint64 hits() const { return m_hits; }
+    quint64 misses() const { return m_misses; }
+    quint64 evictions() const { return m_evictions; }
+
+private:
+    static bool canEvict(KDirectory* dir);
+    void release(KDirectory* dir);
+    void evicted(KDirectory* dir);
+
+    AltLRU<KDirectory*> m_lru;
+    QHash<KDirectory*, QString> m_keys;
+
+    qint64 m_budget;
+    quint64 m_hits;
+    quint64 m_misses;
+    quint64 m_evictions;
+};
+
+#endif // KDIRECTORYCACHE_P_H
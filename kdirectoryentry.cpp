@@ -18,287 +18,191 @@
 */
 
 #include "kdirectoryentry.h"
-#include "staticmimetype.h"
+#include "kdirectoryentrystore.h"
 
-// Qt includes
-#include <QMimeDatabase>
-#include <QMimeType>
-#include <QDir>
-#include <QDateTime>
-#include <QDebug>
-#include <qplatformdefs.h>
+// The entry details are not loaded from within this class. This class doesn't inherit
+// QObject and shouldn't do so since we can get A LOT of these objects!
+// Remember, every file is one entry in the KDirectoryEntryStore.
+//
+// External users of this class should first check if an entry has details loaded.
+// If not call KDirectory::loadEntryDetails to load the details and verify that
+// the details are actually loaded by waiting for KDirectory::entriesDetailsChanged.
 
-
-class KDirectoryEntryPrivate
+KDirectoryEntry::KDirectoryEntry()
+    : d()
+    , m_index(-1)
 {
-public:
-    KDirectoryEntryPrivate()
-        : m_fullUDSEntryLoaded(false)
-        , m_entry()
-    {
-    }
-
-    // The entry details can - technically - be loaded from within this class.
-    // However, then we have a signal/slot issue. This class doesn't inherit QObject
-    // and shouldn't do so since we can get A LOT of these classes in memory!
-    // Remember, every file is one instance of this class.
-    // So we only call this function through KDirectoryEntry::loadEntryDetails which
-    // should be called from outside this class in some parent class that does have
-    // QObject inheritance.
-    //
-    // External users of this class should first check if an entry ahs details loaded.
-    // If not call KDirectory::loadEntryDetails to load the details and verify that
-    // the details are actually loaded by calling KDirectoryEntry::entryDetailsChanged.
-
-    const QString name()
-    {
-        return m_entry.stringValue(KIO::UDSEntry::UDS_NAME);
-    }
-
-    const QString basename()
-    {
-        const QString name = m_entry.stringValue(KIO::UDSEntry::UDS_NAME);
-        int dotPosition = name.lastIndexOf(QStringLiteral("."));
-
-        // If the first character is a dot then we have a file or folder that apparently wants to be hidden. Thread as basename.
-        if(dotPosition == 0) {
-            return name;
-        }
-        return name.left(dotPosition);
-    }
-
-    const QString extension()
-    {
-        const QString name = m_entry.stringValue(KIO::UDSEntry::UDS_NAME);
-
-        if(!name.isEmpty() && name[0] != QChar('.')) {
-            int lastDot = name.lastIndexOf(QStringLiteral("."));
-
-            if(lastDot > 0) {
-                int dotPosition = name.length() - lastDot - 1;
-                return name.right(dotPosition);
-            }
-        }
-        return QString();
-    }
-
-    bool isReadable()
-    {
-        if(m_fullUDSEntryLoaded) {
-            return false;
-        }
-
-        // To be implemented
-        // const mode_t readMask = S_IRUSR|S_IRGRP|S_IROTH;
-
-        return false;
-    }
-
-    bool isWritable()
-    {
-        if(m_fullUDSEntryLoaded) {
-            return false;
-        }
-
-        // To be implemented
-        return false;
-    }
+}
 
-    bool isExecutable()
-    {
-        if(m_fullUDSEntryLoaded) {
-            return false;
-        }
+KDirectoryEntry::KDirectoryEntry(const KDirectoryEntryStore *store, int index)
+    : d(const_cast<KDirectoryEntryStore*>(store)) // We never write to a shared store, see detach().
+    , m_index(index)
+{
+}
 
-        // To be implemented
-        return false;
-    }
+KDirectoryEntry::KDirectoryEntry(const KIO::UDSEntry &entry, const QString &details)
+    : d()
+    , m_index(-1)
+{
+    setUDSEntry(entry, details);
+}
 
-    bool isModified()
-    {
-        if(m_fullUDSEntryLoaded) {
-            return false;
-        }
+KDirectoryEntry::KDirectoryEntry(const KDirectoryEntry &other)
+    : d(other.d)
+    , m_index(other.m_index)
+{
+}
 
-        // To be implemented
-        return false;
-    }
+KDirectoryEntry::KDirectoryEntry(KDirectoryEntry &&other)
+    : d()
+    , m_index(other.m_index)
+{
+    d.swap(other.d);
+    other.m_index = -1;
+}
 
-    bool isSystem()
-    {
-        if(m_fullUDSEntryLoaded) {
-            return false;
-        }
+KDirectoryEntry::~KDirectoryEntry()
+{
+}
 
-        // To be implemented
-        return false;
-    }
+KDirectoryEntry &KDirectoryEntry::operator=(const KDirectoryEntry &other)
+{
+    d = other.d;
+    m_index = other.m_index;
+    return *this;
+}
 
-    QDateTime time(KDirectoryEntry::FileTimes which)
-    {
-        if(m_fullUDSEntryLoaded) {
-            long long fieldVal = -1;
-            switch ( which ) {
-            case KDirectoryEntry::FileTimes::ModificationTime:
-                fieldVal = m_entry.numberValue( KIO::UDSEntry::UDS_MODIFICATION_TIME, -1 );
-                break;
-            case KDirectoryEntry::FileTimes::AccessTime:
-                fieldVal = m_entry.numberValue( KIO::UDSEntry::UDS_ACCESS_TIME, -1 );
-                break;
-            case KDirectoryEntry::FileTimes::CreationTime:
-                fieldVal = m_entry.numberValue( KIO::UDSEntry::UDS_CREATION_TIME, -1 );
-                break;
-            }
-            if (fieldVal != -1) {
-                return QDateTime::fromMSecsSinceEpoch(1000 *fieldVal);
-            }
-        }
-        return QDateTime();
-    }
+KDirectoryEntry &KDirectoryEntry::operator=(KDirectoryEntry &&other)
+{
+    d.swap(other.d);
+    qSwap(m_index, other.m_index);
+    return *this;
+}
 
-    bool isHidden()
-    {
-        const QString fname = m_entry.stringValue(KIO::UDSEntry::UDS_NAME);
-        if(fname.length() > 0 && fname[0] == '.') {
-            return true;
-        } else {
-            return false;
-        }
-    }
+bool KDirectoryEntry::isValid() const
+{
+    return d && m_index >= 0 && m_index < d->count();
+}
 
-    bool isDir()
-    {
-        return (m_entry.numberValue(KIO::UDSEntry::UDS_FILE_TYPE) & QT_STAT_MASK) == QT_STAT_DIR;
-    }
+void KDirectoryEntry::setUDSEntry(const KIO::UDSEntry &entry, const QString &details)
+{
+    // Details comes from the directory lister. If it's 0 then we only have very few details in the entry object.
+    const bool detailsLoaded = (details != "0");
 
-    const StaticMimeType mimeType()
-    {
-        QString fName = name();
-        QString ext = extension();
-        if(isDir()) {
-            fName = QDir::separator();
-            ext = ".directory";
-        }
-
-        // This caching is based on the extension.
-        static QHash<QString, StaticMimeType> mimeCache;
-        if(!mimeCache.contains(ext)) {
-            mimeCache.insert(ext, StaticMimeType(fName));
-        }
-
-        return mimeCache.value(ext);
+    if(!isValid()) {
+        d = new KDirectoryEntryStore();
+        m_index = d->append(entry, detailsLoaded);
+        return;
     }
 
-    const QString iconName()
-    {
-        return mimeType().iconName;
-    }
+    detach();
+    d->update(m_index, entry, detailsLoaded);
+}
 
-    const QString mimeComment()
-    {
-        return mimeType().comment;
+void KDirectoryEntry::detach()
+{
+    // Only when we are the sole owner of the store we are allowed to write to it. Otherwise we copy our
+    // row into a store of our own. Copying the complete store would be a waste, it can have millions of entries.
+    if(d && d->ref.load() != 1) {
+        KDirectoryEntryStore* store = new KDirectoryEntryStore();
+        const int index = store->append(*d, m_index);
+        d = store;
+        m_index = index;
     }
+}
 
-    const KIO::filesize_t size()
-    {
-        if(!isDir() && m_fullUDSEntryLoaded) {
-            return m_entry.numberValue(KIO::UDSEntry::UDS_SIZE);
-        }
-        return 0;
-    }
+const QString KDirectoryEntry::name() const
+{
+    return isValid() ? d->name(m_index) : QString();
+}
 
-    const QString user()
-    {
-        if(m_fullUDSEntryLoaded) {
-            return m_entry.stringValue(KIO::UDSEntry::UDS_USER);
-        }
-        return QString();
-    }
+QStringRef KDirectoryEntry::nameRef() const
+{
+    return isValid() ? d->nameRef(m_index) : QStringRef();
+}
 
-    const QString group()
-    {
-        if(m_fullUDSEntryLoaded) {
-            return m_entry.stringValue(KIO::UDSEntry::UDS_GROUP);
-        }
-        return QString();
-    }
+QStringRef KDirectoryEntry::basenameRef() const
+{
+    return isValid() ? d->basenameRef(m_index) : QStringRef();
+}
 
-    bool m_fullUDSEntryLoaded;
-    KIO::UDSEntry m_entry;
-};
+QStringRef KDirectoryEntry::extensionRef() const
+{
+    return isValid() ? d->extensionRef(m_index) : QStringRef();
+}
 
-KDirectoryEntry::KDirectoryEntry()
-    : d(new KDirectoryEntryPrivate())
+QVariant KDirectoryEntry::nameVariant() const
 {
+    return QVariant(name());
 }
 
-KDirectoryEntry::KDirectoryEntry(const KIO::UDSEntry &entry, const QString &details)
-    : d(new KDirectoryEntryPrivate())
+QVariant KDirectoryEntry::basenameVariant() const
 {
-    setUDSEntry(entry, details);
+    return QVariant(basename());
 }
 
-const QString KDirectoryEntry::name() const
+QVariant KDirectoryEntry::extensionVariant() const
 {
-    return d->name();
+    // The extension is a dictionary value. This shares the string instead of allocating a new one.
+    return QVariant(extension());
 }
 
 const QString KDirectoryEntry::user() const
 {
-    return d->user();
+    return (isValid() && detailsLoaded()) ? d->user(m_index) : QString();
 }
 
 const QString KDirectoryEntry::group() const
 {
-    return d->group();
+    return (isValid() && detailsLoaded()) ? d->group(m_index) : QString();
 }
 
 const QString KDirectoryEntry::basename() const
 {
-    return d->basename();
+    return isValid() ? d->basename(m_index) : QString();
 }
 
 const QString KDirectoryEntry::extension() const
 {
-    return d->extension();
+    return isValid() ? d->extension(m_index) : QString();
 }
 
 const QString KDirectoryEntry::iconName() const
 {
-
-    return d->iconName();
+    return isValid() ? d->iconName(m_index) : QString();
 }
 
 const QString KDirectoryEntry::mimeComment() const
 {
+    return isValid() ? d->mimeComment(m_index) : QString();
+}
 
-    return d->mimeComment();
+int KDirectoryEntry::mimeTypeId() const
+{
+    return isValid() ? d->mimeTypeId(m_index) : 0;
 }
 
 const KIO::filesize_t KDirectoryEntry::size() const
 {
-    return d->size();
+    if(isValid() && !isDir() && detailsLoaded()) {
+        return d->size(m_index);
+    }
+    return 0;
 }
 
-void KDirectoryEntry::setUDSEntry(const KIO::UDSEntry &entry, const QString &details)
+quint16 KDirectoryEntry::attributes() const
 {
-    // Details comes from the directory lister. If it's 0 then we only have very few details in the entry object.
-    if(details == "0") {
-        d->m_fullUDSEntryLoaded = false;
-    } else {
-        d->m_fullUDSEntryLoaded = true;
-    }
-    d->m_entry = entry;
+    return isValid() ? d->attributes(m_index) : 0;
 }
 
 bool KDirectoryEntry::isLink() const
 {
-    return d->m_entry.contains(KIO::UDSEntry::UDS_LINK_DEST); // Link location is not stored, only that it is a link
+    return attributes() & Link;
 }
 
 bool KDirectoryEntry::isDir() const
 {
-    return d->isDir();
+    return attributes() & Dir;
 }
 
 bool KDirectoryEntry::isFile() const
@@ -308,40 +212,51 @@ bool KDirectoryEntry::isFile() const
 
 bool KDirectoryEntry::isReadable() const
 {
-    return d->isReadable();
+    return attributes() & Readable;
 }
 
 bool KDirectoryEntry::isWritable() const
 {
-    return d->isWritable();
+    return attributes() & Writable;
 }
 
 bool KDirectoryEntry::isExecutable() const
 {
-    return d->isExecutable();
+    return attributes() & Executable;
 }
 
 bool KDirectoryEntry::isModified() const
 {
-    return d->isModified();
+    return false;
 }
 
 bool KDirectoryEntry::isSystem() const
 {
-    return d->isSystem();
+    return attributes() & System;
 }
 
 QDateTime KDirectoryEntry::time(KDirectoryEntry::FileTimes which) const
 {
-    return d->time(which);
+    if(isValid() && detailsLoaded()) {
+        return d->time(m_index, which);
+    }
+    return QDateTime();
+}
+
+qint64 KDirectoryEntry::timestamp(KDirectoryEntry::FileTimes which) const
+{
+    if(isValid() && detailsLoaded()) {
+        return d->timestamp(m_index, which);
+    }
+    return -1;
 }
 
 bool KDirectoryEntry::isHidden() const
 {
-    return d->isHidden();
+    return attributes() & Hidden;
 }
 
 bool KDirectoryEntry::detailsLoaded() const
 {
-    return d->m_fullUDSEntryLoaded;
+    return attributes() & DetailsLoaded;
 }
@@ -21,14 +21,34 @@
 #define KDIRECTORYENTRY_H
 
 #include <QString>
-#include <QBitArray>
+#include <QStringRef>
+#include <QSharedData>
+#include <QVariant>
+#include <QDateTime>
 
 #include <kio/udsentry.h>
 #include <kio/global.h> // for KIO::filesize_t
 #include <kde_file.h>
 
-class KDirectoryEntryPrivate;
-
+class KDirectoryEntryStore;
+
+/**
+ * A KDirectoryEntry is a lightweight handle on one entry in a KDirectoryEntryStore.
+ * It is nothing more then a (reference counted) pointer to the store and an index in it,
+ * so creating, copying and moving these objects is cheap. The data itself lives in the
+ * store owned by KDirectory.
+ *
+ * Entries handed out by KDirectory are live views on the store of that directory, not snapshots.
+ * The directory changes it's store in place and never copies it for entries that are still out
+ * there: details that come in, a relist, entries that are added, removed or sorted. Sorting only
+ * changes the rows, not the store, so an entry keeps pointing at the same file when rows are added
+ * or moved. After KDirectory reported removed rows it refers to whatever is at it's index now (or is
+ * invalid). Ask the directory for the entry again after that signal.
+ * The store stays alive as long as an entry references it, even if the KDirectory is gone.
+ *
+ * The other way around is copy on write. Calling a non const function (setUDSEntry) detaches the
+ * entry into it's own single entry store, the directory itself is never changed through an entry.
+ */
 class KDirectoryEntry
 {
 public:
@@ -44,9 +64,50 @@ public:
         CreationTime
     };
 
-    KDirectoryEntry(); // Keeps QVector happy.
+    /**
+     * Attribute bits of an entry. These are calculated once when the entry comes in (and
+     * again when details are loaded) so that filtering is a simple mask test.
+     * - Dir, File and System: the type. Every entry has exactly one of those. System is
+     *   anything that isn't a regular file or folder (FIFOs, sockets and device files).
+     * - Readable, Writable and Executable: the permissions for the current user. If the
+     *   permissions aren't known (yet) these are set.
+     * - Dot and DotDot: the "." and ".." entries.
+     */
+    enum Attribute {
+        DetailsLoaded = 0x1,
+        Link = 0x2,
+        Dir = 0x4,
+        File = 0x8,
+        System = 0x10,
+        Hidden = 0x20,
+        Readable = 0x40,
+        Writable = 0x80,
+        Executable = 0x100,
+        Dot = 0x200,
+        DotDot = 0x400
+    };
+
+    KDirectoryEntry(); // Keeps QVector happy. This is an invalid (empty) entry.
+    KDirectoryEntry(const KDirectoryEntryStore* store, int index);
     KDirectoryEntry(const KIO::UDSEntry& entry, const QString& details = "0");
-    virtual ~KDirectoryEntry(){}
+    KDirectoryEntry(const KDirectoryEntry& other);
+    KDirectoryEntry(KDirectoryEntry&& other);
+    ~KDirectoryEntry();
+
+    KDirectoryEntry& operator=(const KDirectoryEntry& other);
+    KDirectoryEntry& operator=(KDirectoryEntry&& other);
+
+    /**
+     * Returns true if this entry points to an existing entry in a store.
+     * @return bool
+     */
+    bool isValid() const;
+
+    /**
+     * The index of this entry in the store it belongs to.
+     * @return int
+     */
+    int index() const { return m_index; }
 
     /**
      * Returns the raw file name with extension as it comes from UDSEntry.
@@ -54,6 +115,25 @@ public:
      */
     const QString name() const;
 
+    /**
+     * Non owning views on the name, base name and extension. These point directly into the
+     * name storage of the KDirectoryEntryStore, no string is allocated. Use these in sort,
+     * filter and group code. Don't keep them around, they are only valid as long as the
+     * KDirectory they come from exists.
+     * @return QStringRef
+     */
+    QStringRef nameRef() const;
+    QStringRef basenameRef() const;
+    QStringRef extensionRef() const;
+
+    /**
+     * QVariant versions of the above. These are meant for the model roles (and thus QML), which need a QVariant anyway.
+     * @return QVariant holding a QString
+     */
+    QVariant nameVariant() const;
+    QVariant basenameVariant() const;
+    QVariant extensionVariant() const;
+
     /**
      * Returns the owner of the file.
      * @return QString
@@ -90,6 +170,13 @@ public:
      */
     const QString mimeComment() const;
 
+    /**
+     * Returns the KMimeTypeRegistry id of this entry. Use KMimeTypeRegistry::self()->mimeType(id)
+     * to get the icon name and comment. That works from any thread.
+     * @return int
+     */
+    int mimeTypeId() const;
+
     /**
      * Returns the file size from UDSEntry if details where loaded. 0 for no details or if the current entry is a folder.
      * @return QString
@@ -97,9 +184,18 @@ public:
     const KIO::filesize_t size() const;
 
     /**
-     * This is used internally when constructing this object with an UDSEntry, or used externally to update this object. For example when a rename happens. Users using this class cannot use this object to get notified of changes. The KDirectory object containing this instance will notify you of changes.
+     * Updates this entry with the values from @p entry. The entry is detached first if it
+     * shares it's data with a KDirectory or with other entries. Users using this class cannot
+     * use this object to get notified of changes. The KDirectory object containing this
+     * instance will notify you of changes.
      */
-    virtual void setUDSEntry(const KIO::UDSEntry& entry, const QString& details = "0");
+    void setUDSEntry(const KIO::UDSEntry& entry, const QString& details = "0");
+
+    /**
+     * Returns the Attribute bits of this entry.
+     * @return quint16
+     */
+    quint16 attributes() const;
 
     /**
      * Returns true if this item represents a link in the UNIX sense of
@@ -126,7 +222,6 @@ public:
      * @return true if the file can be read - more precisely,
      *         false if we know for sure it can't
      */
-    // STUB! To be implemented
     bool isReadable() const;
 
     /**
@@ -135,16 +230,24 @@ public:
      * @return true if the file or directory can be written to - more precisely,
      *         false if we know for sure it can't
      */
-    // STUB! To be implemented
     bool isWritable() const;
 
-    // STUB! To be implemented
+    /**
+     * Checks whether the file or directory is executable (can be entered for a directory)
+     * by the current user.
+     * @return true if the file can be executed, false if we know for sure it can't
+     */
     bool isExecutable() const;
 
-    // STUB! To be implemented
+    /**
+     * Always false. Just like QDir::Modified this is ignored on Unix.
+     */
     bool isModified() const;
 
-    // STUB! To be implemented
+    /**
+     * Checks whether the entry is a system file. On Unix those are FIFOs, sockets and device files.
+     * @return true if the entry is a system file.
+     */
     bool isSystem() const;
 
     /**
@@ -155,6 +258,15 @@ public:
      */
     QDateTime time(FileTimes which) const;
 
+    /**
+     * Same as time() but as the raw number of seconds since epoch. Use this when comparing or
+     * grouping entries on time, it doesn't create a QDateTime.
+     * @param which the timestamp
+     * @return seconds since epoch, -1 if not available
+     * @see FileTimes
+     */
+    qint64 timestamp(FileTimes which) const;
+
     /**
      * Checks whether the file is hidden.
      * @return true if the file is hidden.
@@ -168,7 +280,10 @@ public:
     bool detailsLoaded() const;
 
 private:
-    KDirectoryEntryPrivate* d;
+    void detach();
+
+    QExplicitlySharedDataPointer<KDirectoryEntryStore> d;
+    int m_index;
 };
 
 Q_DECLARE_TYPEINFO(KDirectoryEntry, Q_MOVABLE_TYPE);
@@ -0,0 +1,125 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "kdirectoryentrydictionary.h"
+
+#include <algorithm>
+
+KDirectoryEntryDictionary::KDirectoryEntryDictionary()
+    : m_values()
+    , m_codes()
+    , m_lastCode(0)
+    , m_ranks()
+    , m_ranksDirty(true)
+{
+    clear();
+}
+
+int KDirectoryEntryDictionary::insert(const QString &value)
+{
+    if(m_values.at(m_lastCode) == value) {
+        return m_lastCode;
+    }
+
+    QHash<QString, int>::const_iterator it = m_codes.constFind(value);
+    if(it != m_codes.constEnd()) {
+        m_lastCode = it.value();
+        return m_lastCode;
+    }
+
+    m_lastCode = m_values.count();
+    m_values.append(value);
+    m_codes.insert(value, m_lastCode);
+    m_ranksDirty = true;
+    return m_lastCode;
+}
+
+int KDirectoryEntryDictionary::insert(const QStringRef &value)
+{
+    // Only make a QString out of the view if we really need to.
+    if(m_values.at(m_lastCode) == value) {
+        return m_lastCode;
+    }
+    return insert(value.toString());
+}
+
+int KDirectoryEntryDictionary::code(const QString &value) const
+{
+    return m_codes.value(value, -1);
+}
+
+int KDirectoryEntryDictionary::rank(int code) const
+{
+    return ranks().at(code);
+}
+
+const QVector<int> &KDirectoryEntryDictionary::ranks() const
+{
+    if(m_ranksDirty) {
+        updateRanks();
+    }
+    return m_ranks;
+}
+
+void KDirectoryEntryDictionary::clear()
+{
+    m_values.clear();
+    m_codes.clear();
+
+    // Code 0 is reserved for the empty string. Entries without a value (folders don't have an extension) get this code.
+    m_values.append(QString());
+    m_codes.insert(QString(), 0);
+    m_lastCode = 0;
+    m_ranksDirty = true;
+}
+
+qint64 KDirectoryEntryDictionary::memoryUsage() const
+{
+    qint64 bytes = sizeof(KDirectoryEntryDictionary);
+    bytes += qint64(m_values.capacity()) * sizeof(QString);
+
+    // The keys in m_codes share their data with m_values, the characters are only counted once.
+    for(const QString& value : m_values) {
+        bytes += qint64(value.capacity()) * sizeof(QChar);
+    }
+    bytes += qint64(m_codes.size()) * (sizeof(QString) + sizeof(int) + 2 * sizeof(void*));
+    bytes += qint64(m_ranks.capacity()) * sizeof(int);
+    return bytes;
+}
+
+void KDirectoryEntryDictionary::updateRanks() const
+{
+    // Sort the codes by their value, the position of a code in that sorted list is it's rank.
+    // This is only as expensive as the number of distinct values, which is small for the columns we use this for.
+    const int numOfValues = m_values.count();
+    QVector<int> sortedCodes(numOfValues);
+    for(int i = 0; i < numOfValues; i++) {
+        sortedCodes[i] = i;
+    }
+
+    std::sort(sortedCodes.begin(), sortedCodes.end(), [&](int a, int b) {
+        return m_values.at(a).compare(m_values.at(b)) < 0;
+    });
+
+    m_ranks.resize(numOfValues);
+    for(int i = 0; i < numOfValues; i++) {
+        m_ranks[sortedCodes[i]] = i;
+    }
+    m_ranksDirty = false;
+}
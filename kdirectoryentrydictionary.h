@@ -0,0 +1,101 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KDIRECTORYENTRYDICTIONARY_H
+#define KDIRECTORYENTRYDICTIONARY_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+/**
+ * Dictionary for low cardinality string columns (user, group, extension, ...).
+ *
+ * Every distinct value gets a code. Codes are handed out in order of appearance and
+ * never change, so they can be stored per entry. Code 0 is always the empty string.
+ * Besides the code every value has a rank: the position of the value when all values
+ * in this dictionary are sorted. Comparing ranks gives the same result as comparing
+ * the strings themselves (QString::compare), but without touching any string.
+ */
+class KDirectoryEntryDictionary
+{
+public:
+    KDirectoryEntryDictionary();
+
+    /**
+     * Returns the code for @p value. The value is added if it isn't known yet.
+     * @return int code
+     */
+    int insert(const QString& value);
+    int insert(const QStringRef& value);
+
+    /**
+     * Returns the code for @p value or -1 if the value isn't in this dictionary.
+     * @return int code
+     */
+    int code(const QString& value) const;
+
+    /**
+     * Returns the string for @p code. No string is copied.
+     * @return QString
+     */
+    const QString& value(int code) const { return m_values.at(code); }
+
+    /**
+     * Number of distinct values (including the empty string).
+     * @return int
+     */
+    int count() const { return m_values.count(); }
+
+    /**
+     * Returns the rank of @p code. A lower rank means the value sorts before values with a higher rank.
+     * @return int rank
+     */
+    int rank(int code) const;
+
+    /**
+     * Returns the rank for every code (the vector index is the code). Take a copy of this
+     * if you need to compare ranks in another thread.
+     * @return QVector<int>
+     */
+    const QVector<int>& ranks() const;
+
+    void clear();
+
+    /**
+     * Bytes allocated by this dictionary, the values and the lookup tables.
+     * @return qint64 bytes
+     */
+    qint64 memoryUsage() const;
+
+private:
+    void updateRanks() const;
+
+    QVector<QString> m_values;
+    QHash<QString, int> m_codes;
+
+    // Most of the time the same value comes in many times after each other (same user, same group).
+    int m_lastCode;
+
+    // The ranks are only calculated when they are needed and become invalid when a new value is inserted.
+    mutable QVector<int> m_ranks;
+    mutable bool m_ranksDirty;
+};
+
+#endif // KDIRECTORYENTRYDICTIONARY_H
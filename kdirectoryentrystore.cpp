@@ -0,0 +1,680 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "kdirectoryentrystore.h"
+#include "kmimetyperegistry.h"
+
+// Qt includes
+#include <QSet>
+#include <qplatformdefs.h>
+
+// KDE includes
+#include <KUser>
+
+namespace {
+    // Who we are doesn't change while running, so figure it out once.
+    struct CurrentUser {
+        QString loginName;
+        QSet<QString> groupNames;
+        bool isSuperUser;
+    };
+
+    const CurrentUser& currentUser()
+    {
+        static const CurrentUser user = [](){
+            KUser kuser(KUser::UseEffectiveUID);
+            CurrentUser u;
+            u.loginName = kuser.loginName();
+            u.groupNames = QSet<QString>::fromList(kuser.groupNames());
+            u.isSuperUser = kuser.isSuperUser();
+            return u;
+        }();
+        return user;
+    }
+}
+
+KDirectoryEntryStore::KDirectoryEntryStore()
+    : m_names()
+    , m_nameOffsets()
+    , m_dotOffsets()
+    , m_modes()
+    , m_sizes()
+    , m_modificationTimes()
+    , m_accessTimes()
+    , m_creationTimes()
+    , m_mimeTypeIds()
+    , m_mimeTypeIdForExtension()
+    , m_attributes()
+    , m_fingerprints()
+    , m_nameIndex()
+    , m_nameIndexCount(0)
+{
+}
+
+void KDirectoryEntryStore::reserve(int size)
+{
+    // Called for every batch, so grow at least by half like append would. Reserving exactly what is needed would
+    // copy all columns again with every batch.
+    const int numOfEntries = count();
+    if(numOfEntries + size <= m_modes.capacity()) {
+        return;
+    }
+    const int newSize = qMax(numOfEntries + size, numOfEntries + numOfEntries / 2);
+
+    // Names are on average somewhere around 16 characters. It doesn't have to be exact, it only prevents most reallocations.
+    m_names.reserve(m_names.size() + (newSize - numOfEntries) * 16);
+    m_nameOffsets.reserve(newSize);
+    m_dotOffsets.reserve(newSize);
+    m_modes.reserve(newSize);
+    m_sizes.reserve(newSize);
+    m_modificationTimes.reserve(newSize);
+    m_accessTimes.reserve(newSize);
+    m_creationTimes.reserve(newSize);
+    m_mimeTypeIds.reserve(newSize);
+    for(QVector<int>& codes : m_codes) {
+        codes.reserve(newSize);
+    }
+    m_attributes.reserve(newSize);
+    m_fingerprints.reserve(newSize);
+}
+
+void KDirectoryEntryStore::clear()
+{
+    m_names.clear();
+    m_nameOffsets.clear();
+    m_dotOffsets.clear();
+    m_modes.clear();
+    m_sizes.clear();
+    m_modificationTimes.clear();
+    m_accessTimes.clear();
+    m_creationTimes.clear();
+    m_mimeTypeIds.clear();
+    m_mimeTypeIdForExtension.clear();
+    for(int i = 0; i < DictionaryColumnCount; i++) {
+        m_codes[i].clear();
+        m_dictionaries[i].clear();
+    }
+    m_attributes.clear();
+    m_fingerprints.clear();
+    m_nameIndex.clear();
+    m_nameIndexCount = 0;
+}
+
+void KDirectoryEntryStore::squeeze()
+{
+    m_names.squeeze();
+    m_nameOffsets.squeeze();
+    m_dotOffsets.squeeze();
+    m_modes.squeeze();
+    m_sizes.squeeze();
+    m_modificationTimes.squeeze();
+    m_accessTimes.squeeze();
+    m_creationTimes.squeeze();
+    m_mimeTypeIds.squeeze();
+    for(QVector<int>& codes : m_codes) {
+        codes.squeeze();
+    }
+    m_attributes.squeeze();
+    m_fingerprints.squeeze();
+}
+
+qint64 KDirectoryEntryStore::memoryUsage() const
+{
+    qint64 bytes = sizeof(KDirectoryEntryStore);
+    bytes += qint64(m_names.capacity()) * sizeof(QChar);
+    bytes += qint64(m_nameOffsets.capacity()) * sizeof(int);
+    bytes += qint64(m_dotOffsets.capacity()) * sizeof(int);
+    bytes += qint64(m_modes.capacity()) * sizeof(uint);
+    bytes += qint64(m_sizes.capacity()) * sizeof(KIO::filesize_t);
+    bytes += qint64(m_modificationTimes.capacity() + m_accessTimes.capacity() + m_creationTimes.capacity()) * sizeof(qint64);
+    bytes += qint64(m_mimeTypeIds.capacity()) * sizeof(quint16);
+    bytes += qint64(m_mimeTypeIdForExtension.capacity()) * sizeof(int);
+    for(int i = 0; i < DictionaryColumnCount; i++) {
+        bytes += qint64(m_codes[i].capacity()) * sizeof(int);
+        bytes += m_dictionaries[i].memoryUsage();
+    }
+    bytes += qint64(m_attributes.capacity()) * sizeof(quint16);
+    bytes += qint64(m_fingerprints.capacity()) * sizeof(quint64);
+
+    // QHash doesn't tell how much it allocated. Every node holds the key, the value and the next pointer,
+    // the bucket array has about one pointer per node.
+    bytes += qint64(m_nameIndex.size()) * (sizeof(uint) + sizeof(int) + 2 * sizeof(void*));
+    return bytes;
+}
+
+int KDirectoryEntryStore::append(const KIO::UDSEntry &entry, bool detailsLoaded)
+{
+    const QString name = entry.stringValue(KIO::UDSEntry::UDS_NAME);
+    m_nameOffsets.append(m_names.size());
+    m_names.append(name);
+
+    // In a recursive listing the name is a relative path. Only a dot in the last part of it counts, and not
+    // when it's the first character of that part (a hidden file): "sub/.hidden" has no extension.
+    const int fileNameStart = name.lastIndexOf(QLatin1Char('/')) + 1;
+    const int lastDot = name.lastIndexOf(QLatin1Char('.'));
+    m_dotOffsets.append(lastDot > fileNameStart ? lastDot : -1);
+
+    // Append default values, setDetails fills them in.
+    m_modes.append(0);
+    m_sizes.append(0);
+    m_modificationTimes.append(-1);
+    m_accessTimes.append(-1);
+    m_creationTimes.append(-1);
+    m_mimeTypeIds.append(KMimeTypeRegistry::InvalidId);
+    for(QVector<int>& codes : m_codes) {
+        codes.append(0);
+    }
+    m_attributes.append(0);
+    m_fingerprints.append(fingerprint(entry));
+
+    const int index = count() - 1;
+    setDetails(index, entry, detailsLoaded);
+
+    // The extension and mime type don't change on a detail update, so we only need to figure them out once.
+    const int extensionCode = m_dictionaries[ExtensionColumn].insert(extensionRef(index));
+    m_codes[ExtensionColumn][index] = extensionCode;
+
+    // Folders and files without extension go to the registry directly (the registry is fast for those too),
+    // everything else is looked up once per extension in this directory.
+    int mimeTypeId = -1;
+    if(!isDir(index) && extensionCode > 0) {
+        mimeTypeId = m_mimeTypeIdForExtension.value(extensionCode, -1);
+    }
+    if(mimeTypeId == -1) {
+        mimeTypeId = KMimeTypeRegistry::self()->idForFile(name, m_dictionaries[ExtensionColumn].value(extensionCode), isDir(index));
+        if(!isDir(index) && extensionCode > 0) {
+            while(m_mimeTypeIdForExtension.count() <= extensionCode) {
+                m_mimeTypeIdForExtension.append(-1);
+            }
+            m_mimeTypeIdForExtension[extensionCode] = mimeTypeId;
+        }
+    }
+    m_mimeTypeIds[index] = mimeTypeId;
+
+    const StaticMimeType& mime = mimeType(index);
+    m_codes[MimeCommentColumn][index] = m_dictionaries[MimeCommentColumn].insert(mime.comment);
+    m_codes[IconNameColumn][index] = m_dictionaries[IconNameColumn].insert(mime.iconName);
+
+    if(fileNameStart > 0) {
+        m_codes[ParentColumn][index] = m_dictionaries[ParentColumn].insert(nameRef(index).left(fileNameStart - 1));
+    }
+
+    return index;
+}
+
+int KDirectoryEntryStore::append(const KDirectoryEntryStore &other, int index)
+{
+    m_nameOffsets.append(m_names.size());
+    m_names.append(other.nameRef(index));
+    m_dotOffsets.append(other.m_dotOffsets.at(index));
+
+    // Append default values, copyRow fills them in.
+    m_modes.append(0);
+    m_sizes.append(0);
+    m_modificationTimes.append(-1);
+    m_accessTimes.append(-1);
+    m_creationTimes.append(-1);
+    m_mimeTypeIds.append(KMimeTypeRegistry::InvalidId);
+    for(QVector<int>& codes : m_codes) {
+        codes.append(0);
+    }
+    m_attributes.append(0);
+    m_fingerprints.append(0);
+
+    const int newIndex = count() - 1;
+    copyRow(newIndex, other, index);
+    return newIndex;
+}
+
+void KDirectoryEntryStore::update(int index, const KIO::UDSEntry &entry, bool detailsLoaded)
+{
+    if(index >= 0 && index < count()) {
+        setDetails(index, entry, detailsLoaded);
+    }
+}
+
+void KDirectoryEntryStore::replace(int index, const KIO::UDSEntry &entry, bool detailsLoaded)
+{
+    if(index >= 0 && index < count()) {
+        setDetails(index, entry, detailsLoaded);
+        m_fingerprints[index] = fingerprint(entry);
+    }
+}
+
+void KDirectoryEntryStore::replace(int index, const KDirectoryEntryStore &other, int otherIndex)
+{
+    if(index >= 0 && index < count()) {
+        copyRow(index, other, otherIndex);
+    }
+}
+
+void KDirectoryEntryStore::removeLast()
+{
+    if(isEmpty()) {
+        return;
+    }
+
+    // Keep the name index in sync if it already covers the last entry.
+    const int last = count() - 1;
+    if(last < m_nameIndexCount) {
+        m_nameIndex.remove(qHash(nameRef(last)), last);
+        m_nameIndexCount = last;
+    }
+
+    m_names.truncate(m_nameOffsets.last());
+    m_nameOffsets.removeLast();
+    m_dotOffsets.removeLast();
+    m_modes.removeLast();
+    m_sizes.removeLast();
+    m_modificationTimes.removeLast();
+    m_accessTimes.removeLast();
+    m_creationTimes.removeLast();
+    m_mimeTypeIds.removeLast();
+    for(QVector<int>& codes : m_codes) {
+        codes.removeLast();
+    }
+    m_attributes.removeLast();
+    m_fingerprints.removeLast();
+}
+
+quint64 KDirectoryEntryStore::fingerprint(const KIO::UDSEntry &entry)
+{
+    // 64 bit FNV-1a. Not cryptographic, it only needs to change when the entry changes.
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    auto mix = [&hash](const void* data, int length) {
+        const uchar* bytes = static_cast<const uchar*>(data);
+        for(int i = 0; i < length; i++) {
+            hash ^= bytes[i];
+            hash *= Q_UINT64_C(1099511628211);
+        }
+    };
+
+    const QString name = entry.stringValue(KIO::UDSEntry::UDS_NAME);
+    mix(name.constData(), name.size() * sizeof(QChar));
+
+    const qint64 size = entry.numberValue(KIO::UDSEntry::UDS_SIZE, -1);
+    mix(&size, sizeof(size));
+
+    const qint64 modificationTime = entry.numberValue(KIO::UDSEntry::UDS_MODIFICATION_TIME, -1);
+    mix(&modificationTime, sizeof(modificationTime));
+
+    // The inode tells us if the file got replaced (rename over it). Not every slave sends it, the local path is the next best thing.
+    if(entry.contains(KIO::UDSEntry::UDS_INODE)) {
+        const qint64 inode = entry.numberValue(KIO::UDSEntry::UDS_INODE);
+        mix(&inode, sizeof(inode));
+    } else if(entry.contains(KIO::UDSEntry::UDS_LOCAL_PATH)) {
+        const QString localPath = entry.stringValue(KIO::UDSEntry::UDS_LOCAL_PATH);
+        mix(localPath.constData(), localPath.size() * sizeof(QChar));
+    }
+
+    return hash;
+}
+
+int KDirectoryEntryStore::indexOf(const QStringRef &name) const
+{
+    // Add the entries that came in since the last lookup.
+    const int numOfEntries = count();
+    for(; m_nameIndexCount < numOfEntries; m_nameIndexCount++) {
+        m_nameIndex.insert(qHash(nameRef(m_nameIndexCount)), m_nameIndexCount);
+    }
+
+    const uint hash = qHash(name);
+    QMultiHash<uint, int>::const_iterator it = m_nameIndex.constFind(hash);
+    for(; it != m_nameIndex.constEnd() && it.key() == hash; ++it) {
+        if(nameRef(it.value()) == name) {
+            return it.value();
+        }
+    }
+    return -1;
+}
+
+KDirectoryEntryStore::Diff KDirectoryEntryStore::diff(const KDirectoryEntryStore &oldStore, const KDirectoryEntryStore &newStore)
+{
+    Diff result;
+
+    // Walk over the new entries once and look each of them up by name in the old store. Everything in
+    // the old store that didn't get visited that way is gone.
+    const int numOfOld = oldStore.count();
+    const int numOfNew = newStore.count();
+    QVector<bool> seen(numOfOld, false);
+
+    for(int i = 0; i < numOfNew; i++) {
+        const int oldIndex = oldStore.indexOf(newStore.nameRef(i));
+        if(oldIndex == -1) {
+            result.added.append(i);
+        } else {
+            seen[oldIndex] = true;
+            if(oldStore.fingerprint(oldIndex) != newStore.fingerprint(i)) {
+                result.changed.append(qMakePair(oldIndex, i));
+            }
+        }
+    }
+
+    for(int i = 0; i < numOfOld; i++) {
+        if(!seen.at(i)) {
+            result.removed.append(i);
+        }
+    }
+
+    return result;
+}
+
+namespace {
+    // Moves the rows we keep to the front of the column and drops the rest.
+    template<typename T>
+    void compactColumn(QVector<T>& column, const QVector<bool>& removed)
+    {
+        const int numOfRows = column.count();
+        int target = 0;
+        for(int i = 0; i < numOfRows; i++) {
+            if(!removed.at(i)) {
+                column[target++] = column.at(i);
+            }
+        }
+        column.resize(target);
+    }
+}
+
+void KDirectoryEntryStore::remove(const QVector<int> &indexes)
+{
+    if(indexes.isEmpty()) {
+        return;
+    }
+
+    const int numOfEntries = count();
+    QVector<bool> removed(numOfEntries, false);
+    for(const int i : indexes) {
+        removed[i] = true;
+    }
+
+    // The name arena is rebuild. The offsets of the remaining entries all change.
+    QString names;
+    names.reserve(m_names.size());
+    QVector<int> nameOffsets;
+    nameOffsets.reserve(numOfEntries - indexes.count());
+    for(int i = 0; i < numOfEntries; i++) {
+        if(!removed.at(i)) {
+            nameOffsets.append(names.size());
+            names.append(nameRef(i));
+        }
+    }
+    m_names = names;
+    m_nameOffsets = nameOffsets;
+
+    // Every other column just moves up. The dictionaries are left alone, codes stay valid.
+    compactColumn(m_dotOffsets, removed);
+    compactColumn(m_modes, removed);
+    compactColumn(m_sizes, removed);
+    compactColumn(m_modificationTimes, removed);
+    compactColumn(m_accessTimes, removed);
+    compactColumn(m_creationTimes, removed);
+    compactColumn(m_mimeTypeIds, removed);
+    for(QVector<int>& codes : m_codes) {
+        compactColumn(codes, removed);
+    }
+    compactColumn(m_attributes, removed);
+    compactColumn(m_fingerprints, removed);
+
+    // Indexes changed, the name index is rebuild on the next lookup.
+    m_nameIndex.clear();
+    m_nameIndexCount = 0;
+}
+
+QStringRef KDirectoryEntryStore::nameRef(int index) const
+{
+    const int start = m_nameOffsets.at(index);
+    return QStringRef(&m_names, start, nameEnd(index) - start);
+}
+
+QStringRef KDirectoryEntryStore::basenameRef(int index) const
+{
+    const QStringRef name = nameRef(index);
+    const int dotPosition = m_dotOffsets.at(index);
+
+    // No dot, or only the one of a hidden file or folder. The whole name is the basename.
+    if(dotPosition < 0) {
+        return name;
+    }
+    return name.left(dotPosition);
+}
+
+QStringRef KDirectoryEntryStore::extensionRef(int index) const
+{
+    const QStringRef name = nameRef(index);
+    const int lastDot = m_dotOffsets.at(index);
+
+    // The dot of a hidden file isn't an extension, that one isn't in m_dotOffsets (see append).
+    if(lastDot < 0) {
+        return QStringRef();
+    }
+    return name.mid(lastDot + 1);
+}
+
+int KDirectoryEntryStore::parentIndex(int index) const
+{
+    const int parentCode = code(index, ParentColumn);
+    if(parentCode == 0) {
+        return -1;
+    }
+
+    // Parents are looked up by name instead of keeping an index per entry. That way sorting, filtering and removing
+    // entries never has to fix up the tree.
+    return indexOf(m_dictionaries[ParentColumn].value(parentCode));
+}
+
+QString KDirectoryEntryStore::name(int index) const
+{
+    return nameRef(index).toString();
+}
+
+QString KDirectoryEntryStore::basename(int index) const
+{
+    return basenameRef(index).toString();
+}
+
+QString KDirectoryEntryStore::extension(int index) const
+{
+    return m_dictionaries[ExtensionColumn].value(code(index, ExtensionColumn));
+}
+
+QString KDirectoryEntryStore::user(int index) const
+{
+    return m_dictionaries[UserColumn].value(code(index, UserColumn));
+}
+
+QString KDirectoryEntryStore::group(int index) const
+{
+    return m_dictionaries[GroupColumn].value(code(index, GroupColumn));
+}
+
+QString KDirectoryEntryStore::mimeComment(int index) const
+{
+    return m_dictionaries[MimeCommentColumn].value(code(index, MimeCommentColumn));
+}
+
+QString KDirectoryEntryStore::iconName(int index) const
+{
+    return m_dictionaries[IconNameColumn].value(code(index, IconNameColumn));
+}
+
+KIO::filesize_t KDirectoryEntryStore::size(int index) const
+{
+    return m_sizes.at(index);
+}
+
+QDateTime KDirectoryEntryStore::time(int index, KDirectoryEntry::FileTimes which) const
+{
+    const qint64 fieldVal = timestamp(index, which);
+    if(fieldVal != -1) {
+        return QDateTime::fromMSecsSinceEpoch(1000 * fieldVal);
+    }
+    return QDateTime();
+}
+
+qint64 KDirectoryEntryStore::timestamp(int index, KDirectoryEntry::FileTimes which) const
+{
+    switch (which) {
+    case KDirectoryEntry::ModificationTime:
+        return m_modificationTimes.at(index);
+    case KDirectoryEntry::AccessTime:
+        return m_accessTimes.at(index);
+    case KDirectoryEntry::CreationTime:
+        return m_creationTimes.at(index);
+    }
+    return -1;
+}
+
+const StaticMimeType &KDirectoryEntryStore::mimeType(int index) const
+{
+    return KMimeTypeRegistry::self()->mimeType(m_mimeTypeIds.at(index));
+}
+
+int KDirectoryEntryStore::nameEnd(int index) const
+{
+    if(index + 1 < m_nameOffsets.count()) {
+        return m_nameOffsets.at(index + 1);
+    }
+    return m_names.size();
+}
+
+void KDirectoryEntryStore::copyRow(int index, const KDirectoryEntryStore &other, int otherIndex)
+{
+    // The name (and with it the dot offset) is not copied, it's the same or has just been appended.
+    m_modes[index] = other.m_modes.at(otherIndex);
+    m_sizes[index] = other.m_sizes.at(otherIndex);
+    m_modificationTimes[index] = other.m_modificationTimes.at(otherIndex);
+    m_accessTimes[index] = other.m_accessTimes.at(otherIndex);
+    m_creationTimes[index] = other.m_creationTimes.at(otherIndex);
+    m_mimeTypeIds[index] = other.m_mimeTypeIds.at(otherIndex);
+
+    // Codes are only valid within their own dictionary, so we go through the value.
+    for(int i = 0; i < DictionaryColumnCount; i++) {
+        const int code = other.m_codes[i].at(otherIndex);
+        m_codes[i][index] = m_dictionaries[i].insert(other.m_dictionaries[i].value(code));
+    }
+    m_attributes[index] = other.m_attributes.at(otherIndex);
+    m_fingerprints[index] = other.m_fingerprints.at(otherIndex);
+}
+
+void KDirectoryEntryStore::setDetails(int index, const KIO::UDSEntry &entry, bool detailsLoaded)
+{
+    // The file type is always send, even without details. The access bits only come with details.
+    uint mode = 0;
+    if(entry.contains(KIO::UDSEntry::UDS_FILE_TYPE)) {
+        mode = entry.numberValue(KIO::UDSEntry::UDS_FILE_TYPE) & QT_STAT_MASK;
+    }
+    if(entry.contains(KIO::UDSEntry::UDS_ACCESS)) {
+        mode |= entry.numberValue(KIO::UDSEntry::UDS_ACCESS) & 07777;
+    }
+    m_modes[index] = mode;
+
+    m_attributes[index] = attributes(entry, detailsLoaded);
+
+    if(detailsLoaded) {
+        if(!isDir(index)) {
+            m_sizes[index] = entry.numberValue(KIO::UDSEntry::UDS_SIZE, 0);
+        }
+        m_modificationTimes[index] = entry.numberValue(KIO::UDSEntry::UDS_MODIFICATION_TIME, -1);
+        m_accessTimes[index] = entry.numberValue(KIO::UDSEntry::UDS_ACCESS_TIME, -1);
+        m_creationTimes[index] = entry.numberValue(KIO::UDSEntry::UDS_CREATION_TIME, -1);
+        m_codes[UserColumn][index] = m_dictionaries[UserColumn].insert(entry.stringValue(KIO::UDSEntry::UDS_USER));
+        m_codes[GroupColumn][index] = m_dictionaries[GroupColumn].insert(entry.stringValue(KIO::UDSEntry::UDS_GROUP));
+    }
+}
+
+quint16 KDirectoryEntryStore::attributes(const KIO::UDSEntry &entry, bool detailsLoaded)
+{
+    quint16 attributes = 0;
+
+    if(detailsLoaded) {
+        attributes |= KDirectoryEntry::DetailsLoaded;
+    }
+
+    if(entry.contains(KIO::UDSEntry::UDS_LINK_DEST)) {
+        attributes |= KDirectoryEntry::Link; // Link location is not stored, only that it is a link
+    }
+
+    // The type
+    const uint fileType = entry.numberValue(KIO::UDSEntry::UDS_FILE_TYPE, 0) & QT_STAT_MASK;
+    switch (fileType) {
+    case QT_STAT_DIR:
+        attributes |= KDirectoryEntry::Dir;
+        break;
+    case S_IFCHR:
+    case S_IFBLK:
+    case S_IFIFO:
+    case S_IFSOCK:
+        attributes |= KDirectoryEntry::System;
+        break;
+    default:
+        attributes |= KDirectoryEntry::File;
+        break;
+    }
+
+    // Hidden entries are just files/folders starting with a "." (on *nix), or the slave tells us it's hidden.
+    const QString name = entry.stringValue(KIO::UDSEntry::UDS_NAME);
+    const int fileNameStart = name.lastIndexOf(QLatin1Char('/')) + 1;
+    if(name.midRef(fileNameStart).startsWith(QLatin1Char('.')) || entry.numberValue(KIO::UDSEntry::UDS_HIDDEN, 0) == 1) {
+        attributes |= KDirectoryEntry::Hidden;
+    }
+    if(name == QLatin1String(".")) {
+        attributes |= KDirectoryEntry::Dot;
+    } else if(name == QLatin1String("..")) {
+        attributes |= KDirectoryEntry::DotDot;
+    }
+
+    // The permissions for the current user. If we don't know them we assume everything is allowed.
+    // In some cases (remote files) that means we say yes even though the action will fail, but we
+    // never say no when it's possible.
+    if(!entry.contains(KIO::UDSEntry::UDS_ACCESS)) {
+        return attributes | KDirectoryEntry::Readable | KDirectoryEntry::Writable | KDirectoryEntry::Executable;
+    }
+
+    const uint access = entry.numberValue(KIO::UDSEntry::UDS_ACCESS) & 0777;
+    const CurrentUser& user = currentUser();
+    const QString owner = entry.stringValue(KIO::UDSEntry::UDS_USER);
+    const QString group = entry.stringValue(KIO::UDSEntry::UDS_GROUP);
+
+    uint permissions = 0;
+    if(user.isSuperUser) {
+        // root can read and write anything, executing still needs at least one x bit (folders can always be entered).
+        permissions = 06 | ((access & 0111 || attributes & KDirectoryEntry::Dir) ? 01 : 0);
+    } else if(owner.isEmpty() && group.isEmpty()) {
+        // We have the bits, but not who they apply to. Any of user, group or other will do.
+        permissions = (access >> 6) | (access >> 3) | access;
+    } else if(owner == user.loginName) {
+        permissions = access >> 6;
+    } else if(user.groupNames.contains(group)) {
+        permissions = access >> 3;
+    } else {
+        permissions = access;
+    }
+
+    if(permissions & 04) {
+        attributes |= KDirectoryEntry::Readable;
+    }
+    if(permissions & 02) {
+        attributes |= KDirectoryEntry::Writable;
+    }
+    if(permissions & 01) {
+        attributes |= KDirectoryEntry::Executable;
+    }
+
+    return attributes;
+}
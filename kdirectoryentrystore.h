@@ -0,0 +1,306 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KDIRECTORYENTRYSTORE_H
+#define KDIRECTORYENTRYSTORE_H
+
+#include <QString>
+#include <QStringRef>
+#include <QVector>
+#include <QSharedData>
+#include <QDateTime>
+#include <QMultiHash>
+#include <QPair>
+
+#include <kio/udsentry.h>
+#include <kio/global.h> // for KIO::filesize_t
+
+#include "kdirectoryentry.h"
+#include "kdirectoryentrydictionary.h"
+#include "staticmimetype.h"
+
+/**
+ * Column oriented (struct of arrays) storage for all entries of one directory.
+ *
+ * Instead of keeping a full KIO::UDSEntry copy per file we only keep the fields we
+ * actually use, each in it's own packed array. All names are stored in one contiguous
+ * UTF-16 arena. An entry is nothing more then an index in those arrays and a
+ * KDirectoryEntry is a cheap (store, index) handle on top of it.
+ *
+ * The store is reference counted by the entries pointing into it. Always create it on
+ * the heap and keep it in a QExplicitlySharedDataPointer.
+ */
+class KDirectoryEntryStore : public QSharedData
+{
+public:
+    /**
+     * The low cardinality columns. Those are not stored as string per entry but as a code
+     * in a per store KDirectoryEntryDictionary.
+     */
+    enum DictionaryColumn {
+        UserColumn = 0,
+        GroupColumn,
+        ExtensionColumn,
+        MimeCommentColumn,
+        IconNameColumn,
+        ParentColumn, // The folder an entry is in, relative to the listed folder. Only used by recursive listings.
+        DictionaryColumnCount
+    };
+
+    /**
+     * The difference between two listings of the same directory, see diff().
+     */
+    struct Diff {
+        // Indexes in the new store of entries that weren't in the old store.
+        QVector<int> added;
+
+        // Indexes in the old store of entries that aren't in the new store anymore.
+        QVector<int> removed;
+
+        // Entries that are in both but have a different fingerprint: (old index, new index).
+        QVector<QPair<int, int> > changed;
+
+        bool isEmpty() const { return added.isEmpty() && removed.isEmpty() && changed.isEmpty(); }
+    };
+
+    KDirectoryEntryStore();
+
+    /**
+     * Number of entries in this store.
+     * @return int
+     */
+    int count() const { return m_modes.count(); }
+    int size() const { return count(); }
+    bool isEmpty() const { return m_modes.isEmpty(); }
+
+    /**
+     * Pre allocate all columns for @p size more entries. Use this when you know how many
+     * entries are about to be appended (for example the size of an UDSEntryList batch).
+     */
+    void reserve(int size);
+    void clear();
+    void squeeze();
+
+    /**
+     * Bytes allocated by this store: the capacity of every column, the name arena, the
+     * dictionaries and the name index. This is what is really in use, not just count() times
+     * the size of an entry.
+     * @return qint64 bytes
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * Appends the fields we're interested in from @p entry to the columns.
+     * @return int the index of the newly added entry.
+     */
+    int append(const KIO::UDSEntry& entry, bool detailsLoaded);
+
+    /**
+     * Appends a copy of the entry at @p index in @p other.
+     * @return int the index of the newly added entry.
+     */
+    int append(const KDirectoryEntryStore& other, int index);
+
+    /**
+     * Overwrites the details for the entry at @p index. The name is left as is. This
+     * is used to store the results of a stat call.
+     */
+    void update(int index, const KIO::UDSEntry& entry, bool detailsLoaded);
+
+    /**
+     * Like update(), but for an entry that changed on disk: the fingerprint is updated too.
+     * @p entry must have the same name as the entry at @p index.
+     */
+    void replace(int index, const KIO::UDSEntry& entry, bool detailsLoaded);
+
+    /**
+     * Overwrites the entry at @p index with the entry at @p otherIndex in @p other. Both
+     * entries must have the same name.
+     */
+    void replace(int index, const KDirectoryEntryStore& other, int otherIndex);
+
+    /**
+     * Removes the last appended entry.
+     */
+    void removeLast();
+
+    /**
+     * Removes the entries at @p indexes. The remaining entries keep their order and move up
+     * to fill the gaps. This is O(n), no matter how many entries are removed.
+     * @param indexes the indexes to remove, sorted ascending without duplicates.
+     */
+    void remove(const QVector<int>& indexes);
+
+    /**
+     * Returns a view on the entry at @p index. This does not allocate.
+     * @return KDirectoryEntry
+     */
+    KDirectoryEntry at(int index) const { return KDirectoryEntry(this, index); }
+    KDirectoryEntry operator[](int index) const { return at(index); }
+
+    // Column accessors. These are used by KDirectoryEntry, you probably want to use that instead.
+    QStringRef nameRef(int index) const;
+    QStringRef basenameRef(int index) const;
+    QStringRef extensionRef(int index) const;
+    QString name(int index) const;
+    QString basename(int index) const;
+    QString extension(int index) const;
+    QString user(int index) const;
+    QString group(int index) const;
+    QString mimeComment(int index) const;
+    QString iconName(int index) const;
+    uint mode(int index) const { return m_modes.at(index); }
+    KIO::filesize_t size(int index) const;
+    QDateTime time(int index, KDirectoryEntry::FileTimes which) const;
+    qint64 timestamp(int index, KDirectoryEntry::FileTimes which) const;
+    int mimeTypeId(int index) const { return m_mimeTypeIds.at(index); }
+    const StaticMimeType& mimeType(int index) const;
+    quint16 attributes(int index) const { return m_attributes.at(index); }
+    bool isDir(int index) const { return m_attributes.at(index) & KDirectoryEntry::Dir; }
+    bool isLink(int index) const { return m_attributes.at(index) & KDirectoryEntry::Link; }
+    bool isHidden(int index) const { return m_attributes.at(index) & KDirectoryEntry::Hidden; }
+    bool detailsLoaded(int index) const { return m_attributes.at(index) & KDirectoryEntry::DetailsLoaded; }
+
+    /**
+     * The attribute column as one packed array, for filtering a whole range of entries in one go.
+     * @return pointer to count() KDirectoryEntry::Attribute bitmasks.
+     */
+    const quint16* attributesData() const { return m_attributes.constData(); }
+
+    /**
+     * Calculates the KDirectoryEntry::Attribute bits for @p entry.
+     * @return quint16
+     */
+    static quint16 attributes(const KIO::UDSEntry& entry, bool detailsLoaded);
+
+    /**
+     * Returns the fingerprint of the entry at @p index. It is calculated from the name, size,
+     * modification time and inode (or local path) as they came in from the listing. Loading
+     * the details later on (update()) doesn't change it, so fingerprints of two listings with
+     * the same details value can be compared to see if an entry changed.
+     * @return quint64
+     */
+    quint64 fingerprint(int index) const { return m_fingerprints.at(index); }
+
+    /**
+     * Calculates the fingerprint for @p entry.
+     * @return quint64
+     */
+    static quint64 fingerprint(const KIO::UDSEntry& entry);
+
+    /**
+     * Returns the index of the entry named @p name or -1 if there is none. The name index is
+     * built the first time this is called and kept up to date from there on.
+     * @return int index
+     */
+    int indexOf(const QStringRef& name) const;
+    int indexOf(const QString& name) const { return indexOf(QStringRef(&name)); }
+
+    /**
+     * Compares two listings of the same directory by name and fingerprint. This is O(n) in the
+     * number of entries of both stores.
+     * @param oldStore the previous listing.
+     * @param newStore the new listing.
+     * @return Diff the added, removed and changed entries.
+     */
+    static Diff diff(const KDirectoryEntryStore& oldStore, const KDirectoryEntryStore& newStore);
+
+    /**
+     * In a recursive listing names are paths relative to the listed folder ("sub/file.txt") and the
+     * entries form a tree. This returns the folder the entry at @p index is in ("sub").
+     * @return QString the relative path of the parent folder, empty for entries directly in the listed folder.
+     */
+    QString parentPath(int index) const { return m_dictionaries[ParentColumn].value(code(index, ParentColumn)); }
+
+    /**
+     * Returns the index of the parent folder of the entry at @p index, see parentPath().
+     * @return int index or -1 for entries directly in the listed folder (or if the parent isn't in this store).
+     */
+    int parentIndex(int index) const;
+
+    /**
+     * Returns the dictionary code for the given @p column of the entry at @p index.
+     * Entries with an equal code have an equal value.
+     * @return int code
+     */
+    int code(int index, DictionaryColumn column) const { return m_codes[column].at(index); }
+
+    /**
+     * Returns the dictionary rank for the given @p column of the entry at @p index.
+     * Comparing ranks is equal to comparing the string values.
+     * @return int rank
+     */
+    int rank(int index, DictionaryColumn column) const { return m_dictionaries[column].rank(code(index, column)); }
+
+    /**
+     * Returns the dictionary for @p column.
+     * @return KDirectoryEntryDictionary
+     */
+    const KDirectoryEntryDictionary& dictionary(DictionaryColumn column) const { return m_dictionaries[column]; }
+
+private:
+    // Reads and writes the columns directly.
+    friend class KDirectorySnapshot;
+
+    int nameEnd(int index) const;
+    void copyRow(int index, const KDirectoryEntryStore& other, int otherIndex);
+    void setDetails(int index, const KIO::UDSEntry& entry, bool detailsLoaded);
+
+    // All names, one after the other. m_nameOffsets holds the start position per entry,
+    // the end is the start of the next entry (or the end of the arena).
+    QString m_names;
+    QVector<int> m_nameOffsets;
+
+    // Position of the last dot within the file name part of the name (-1 if there is none, or if it's
+    // the leading dot of a hidden file). Calculated once when the entry comes in so that basename
+    // and extension are just views on the name arena.
+    QVector<int> m_dotOffsets;
+
+    // UDS_FILE_TYPE and UDS_ACCESS combined in one value, just like st_mode.
+    QVector<uint> m_modes;
+    QVector<KIO::filesize_t> m_sizes;
+
+    // Seconds since epoch or -1 if not available.
+    QVector<qint64> m_modificationTimes;
+    QVector<qint64> m_accessTimes;
+    QVector<qint64> m_creationTimes;
+
+    // KMimeTypeRegistry id per entry.
+    QVector<quint16> m_mimeTypeIds;
+
+    // Cache of the mime type id per extension code so that the registry is only asked once per distinct extension.
+    QVector<int> m_mimeTypeIdForExtension;
+
+    // Per entry codes for the dictionary columns, indexed by DictionaryColumn.
+    QVector<int> m_codes[DictionaryColumnCount];
+    KDirectoryEntryDictionary m_dictionaries[DictionaryColumnCount];
+
+    // KDirectoryEntry::Attribute bits per entry.
+    QVector<quint16> m_attributes;
+
+    // See fingerprint().
+    QVector<quint64> m_fingerprints;
+
+    // Name hash -> index for the first m_nameIndexCount entries. Only built when someone looks up
+    // a name (indexOf), most directories never need it.
+    mutable QMultiHash<uint, int> m_nameIndex;
+    mutable int m_nameIndexCount;
+};
+
+#endif // KDIRECTORYENTRYSTORE_H
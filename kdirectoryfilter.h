@@ -0,0 +1,79 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KDIRECTORYFILTER_H
+#define KDIRECTORYFILTER_H
+
+#include <QDir>
+
+#include "kdirectoryentry.h"
+
+/**
+ * QDir::Filters compiled down to a few KDirectoryEntry::Attribute masks.
+ *
+ * Every entry carries it's attributes as one quint16 (see KDirectoryEntryStore::attributesData()),
+ * so deciding if an entry passes the filter is a couple of AND and compare instructions. No names
+ * are compared and no KDirectoryEntry objects are created. apply() runs that test over a whole
+ * batch of entries in one loop which the compiler can vectorize. That is also what makes changing
+ * the filter of a listed folder (KDirectory::setFilter) cheap.
+ */
+class KDirectoryFilter
+{
+public:
+    // apply() spreads the work over multiple threads from this many entries on (when build with OpenMP).
+    enum { ParallelThreshold = 65536 };
+
+    explicit KDirectoryFilter(QDir::Filters filters = QDir::NoFilter);
+
+    QDir::Filters filters() const { return m_filters; }
+
+    /**
+     * Returns true if an entry with the given @p attributes passes this filter.
+     * @return bool
+     */
+    bool matches(quint16 attributes) const
+    {
+        return !(attributes & m_excluded)
+            && (attributes & m_anyOf)
+            && (attributes & m_allOf) == m_allOf;
+    }
+
+    /**
+     * Evaluates the filter for @p count entries at once.
+     * @param attributes the attribute bits per entry.
+     * @param count number of entries.
+     * @param keep output, set to 1 for every entry that passes the filter and 0 otherwise.
+     * @return int the number of entries that passed.
+     */
+    int apply(const quint16* attributes, int count, quint8* keep) const;
+
+private:
+    QDir::Filters m_filters;
+
+    // An entry with any of these bits is dropped.
+    quint16 m_excluded;
+
+    // An entry needs at least one of these bits (the type: folder, file or system).
+    quint16 m_anyOf;
+
+    // An entry needs all of these bits (the permissions).
+    quint16 m_allOf;
+};
+
+#endif // KDIRECTORYFILTER_H
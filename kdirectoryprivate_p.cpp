@@ -2,73 +2,202 @@
 
 #include <QUrl>
 #include <QDebug>
+#include <QFileInfo>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include <KIO/StatJob>
 
+#include <algorithm>
+#include <numeric>
+
 KDirectoryPrivate::KDirectoryPrivate(KDirectory *dir, const QString& directory)
   : QObject(dir)
   , q(dir)
   , m_directory(directory)
-  , m_filteredEntries()
+  , m_entries(new KDirectoryEntryStore())
+  , m_rows()
+  , m_rowOf()
   , m_filteredEntriesCount(0)
-  , m_unusedEntries()
-  , m_emptyEntry()
-  , m_lastEntry()
-  , m_lastEntryId(-1)
-  , m_statInProgress()
+  , m_statScheduler()
+  , m_statsScheduled(false)
+  , m_changedDetails()
+  , m_detailsChangedTimer()
   , m_job(0)
-  , m_watch(KDirWatch::self())
+  , m_localLister(0)
+  , m_refCount(0)
+  , m_completed(false)
+  , m_cancelled(false)
+  , m_deferredStart(false)
+  , m_listingStarted(false)
+  , m_resultPending(false)
+  , m_pendingBatches()
+  , m_pendingBytes(0)
+  , m_ingestScheduled(false)
+  , m_suspendReasons(0)
+  , m_batchPolicy()
+  , m_statEngine(0)
+  , m_watch(new KDirWatch(this))
+  , m_watchedPath()
+  , m_dirtyNames()
+  , m_deletedNames()
+  , m_folderDirty(false)
+  , m_watchTimer()
+  , m_relistJob(0)
+  , m_relistEntries()
+  , m_relistPending(false)
+  , m_statJobs()
+  , m_reloading(false)
   , m_details()
+  , m_listingDetails()
+  , m_upgradePending(false)
+  , m_upgradeLister(0)
+  , m_upgradeJob(0)
+  , m_recursive(false)
+  , m_listingFailed(false)
+  , m_snapshotsEnabled(false)
+  , m_listingState()
   , m_sortFlags(QDir::NoSort)
-  , m_filterFlags(QDir::NoFilter)
+  , m_collator()
+  , m_sortKeys()
+  , m_filter(QDir::NoFilter)
 {
+    // This makes sure sorting is done in a natural way. Aka, 1, 2, 3, ... 9, 10 instead of 1, 10, ...
+    m_collator.setNumericMode(true);
+
     QUrl goodUrl(m_directory);
     m_directory = goodUrl.url();
-    m_job = KIO::listDir(goodUrl, KIO::HideProgressInfo);
+
+    // Loaded details are reported once per frame (as ranges), not once per entry.
+    m_detailsChangedTimer.setSingleShot(true);
+    m_detailsChangedTimer.setInterval(DefaultDetailsChangedInterval);
+    connect(&m_detailsChangedTimer, &QTimer::timeout, this, &KDirectoryPrivate::flushDetailsChanged);
+
+    m_watchTimer.setSingleShot(true);
+    m_watchTimer.setInterval(DefaultWatchInterval);
+    connect(&m_watchTimer, &QTimer::timeout, this, &KDirectoryPrivate::flushWatchEvents);
+
+    // The details, filter and sorting are set right after we are created. Start listing once they are known.
+    QTimer::singleShot(0, this, SLOT(autoStart()));
+}
+
+void KDirectoryPrivate::autoStart()
+{
+    // Whoever deferred the start calls KDirectory::start() when it's our turn, see KListingScheduler.
+    if(!m_deferredStart) {
+        startListing();
+    }
+}
+
+void KDirectoryPrivate::startListing()
+{
+    if(m_listingStarted || m_cancelled) {
+        return;
+    }
+    m_listingStarted = true;
+
+    const QUrl url(m_directory);
+    m_batchPolicy.start();
+    m_listingDetails = m_details;
+
+    // The state of the folder is taken before listing, if it changes while we list the snapshot won't be trusted.
+    if(m_snapshotsEnabled && url.isLocalFile()) {
+        m_listingState = KDirectorySnapshot::folderState(url.toLocalFile());
+        if(loadSnapshot()) {
+            return;
+        }
+    }
+
+    // Local folders are read directly, no need for a kioslave and sending every entry over a socket.
+    if(url.isLocalFile() && KLocalDirLister::canList(url.toLocalFile())) {
+        m_localLister = new KLocalDirLister(url.toLocalFile(), m_listingDetails, m_recursive, this);
+        connect(m_localLister, &KLocalDirLister::entries, this, &KDirectoryPrivate::queueEntries);
+        connect(m_localLister, &KLocalDirLister::result, this, &KDirectoryPrivate::slotLocalResult);
+        m_localLister->start();
+
+        // The scheduler might have suspended us between start() and now.
+        if(m_suspendReasons) {
+            m_localLister->suspend();
+        }
+        return;
+    }
+
+    // A recursive listing is still one job, the slave walks the sub folders. Hidden entries are listed too, the filter decides about those.
+    m_job = m_recursive ? KIO::listRecursive(url, KIO::HideProgressInfo, true) : KIO::listDir(url, KIO::HideProgressInfo);
     m_job->setUiDelegate(0);
 
     // If any details are set, pass them along to the listener.
-    if(!m_details.isEmpty()) {
-        m_job->addMetaData("details", m_details);
+    if(!m_listingDetails.isEmpty()) {
+        m_job->addMetaData("details", m_listingDetails);
     }
 
     connect(m_job, &KIO::ListJob::entries, this, &KDirectoryPrivate::slotEntries);
     connect(m_job, &KJob::result, this, &KDirectoryPrivate::slotResult);
+
+    if(m_suspendReasons) {
+        m_job->suspend();
+    }
+}
+
+KDirectoryPrivate::~KDirectoryPrivate()
+{
+    // Wait for the workers before anything else goes away, they deliver their results to us.
+    delete m_localLister;
+    delete m_upgradeLister;
+    delete m_statEngine;
+
+    // KIO jobs aren't our children, they would keep on running.
+    if(m_job) {
+        m_job->kill();
+    }
+    if(m_relistJob) {
+        m_relistJob->kill();
+    }
+    if(m_upgradeJob) {
+        m_upgradeJob->kill();
+    }
+    for(KJob* job : m_statJobs) {
+        job->kill();
+    }
+
+    if(!m_watchedPath.isEmpty()) {
+        m_watch->removeDir(m_watchedPath);
+    }
 }
 
 void KDirectoryPrivate::setDetails(const QString &details)
 {
+    // Going from names only to full details. Whatever is listed (or being listed) keeps it's place, only the details are filled in.
+    const bool upgrade = (m_details == "0") && (details == "2") && (m_job || m_localLister || m_completed);
     m_details = details;
-    if(m_job && !m_details.isEmpty()) {
-        m_job->addMetaData("details", m_details);
+    if(upgrade) {
+        upgradeDetails();
     }
 }
 
-const KDirectoryEntry &KDirectoryPrivate::entry(int index)
+KDirectoryEntry KDirectoryPrivate::entry(int index)
 {
-    // No need to check of m_lastEntryId is within the m_filteredEntriesCount because it will only be set if it does
-    if(m_lastEntryId >= 0 && m_lastEntryId == index) {
-        return m_lastEntry;
-    } else if(index >= 0 && index < m_filteredEntriesCount) {
-        m_lastEntryId = index;
-        m_lastEntry = m_filteredEntries.at(index);
-        return m_lastEntry;
-    } else {
-        m_lastEntryId = -1;
-
-        // No known entry so we return the empty entry
-        return m_emptyEntry;
+    if(index >= 0 && index < m_filteredEntriesCount) {
+        return m_entries->at(m_rows.at(index));
     }
+
+    // No known entry so we return the empty entry
+    return KDirectoryEntry();
 }
 
 QDir::Filters KDirectoryPrivate::filter()
 {
-    return m_filterFlags;
+    return m_filter.filters();
 }
 
 void KDirectoryPrivate::setFilter(QDir::Filters filters)
 {
-    m_filterFlags = filters;
+    if(filters == m_filter.filters()) {
+        return;
+    }
+
+    m_filter = KDirectoryFilter(filters);
+    refilter();
 }
 
 QDir::SortFlags KDirectoryPrivate::sorting()
@@ -78,159 +207,458 @@ QDir::SortFlags KDirectoryPrivate::sorting()
 
 void KDirectoryPrivate::setSorting(QDir::SortFlags sort)
 {
+    if(sort == m_sortFlags) {
+        return;
+    }
+
+    // The keys depend on the case sensitivity of the collator, so they are made again.
     m_sortFlags = sort;
+    m_collator.setCaseSensitivity((sort != QDir::NoSort && sort & QDir::IgnoreCase) ? Qt::CaseInsensitive : Qt::CaseSensitive);
+    m_sortKeys.clear();
+    if(m_rows.isEmpty()) {
+        return;
+    }
+
+    // Sort everything we have again, starting from the order the entries came in. The number of rows stays the
+    // same, every row just shows another entry now.
+    QVector<int> indexes = m_rows;
+    std::sort(indexes.begin(), indexes.end());
+    m_rows.clear();
+    processSortFlags(indexes);
+    emit entriesChanged(KDirectoryRanges() << KDirectoryRange(0, m_rows.count() - 1));
 }
 
-bool KDirectoryPrivate::keepEntryAccordingToFilter(KDirectoryEntry entry)
+bool KDirectoryPrivate::isSorted() const
 {
-    // The NoFilter flag rules. If that flag is set all other flags will be ignored.
-    if(m_filterFlags == QDir::NoFilter) {
-        return true;
+    const QDir::SortFlags sortBy = m_sortFlags & QDir::SortByMask;
+    return m_sortFlags != QDir::NoSort && (sortBy != QDir::Unsorted || (m_sortFlags & (QDir::DirsFirst | QDir::DirsLast | QDir::Type)));
+}
+
+// The order of two entries in the store. The sort keys of both have to be there (see processSortFlags).
+bool KDirectoryPrivate::lessThan(int a, int b) const
+{
+    const KDirectoryEntryStore& entries = *m_entries;
+    const QDir::SortFlags sortBy = m_sortFlags & QDir::SortByMask;
+    const bool dirsFirst = m_sortFlags & QDir::DirsFirst;
+    const bool dirsLast = m_sortFlags & QDir::DirsLast;
+
+    // Folders and files are never mixed with DirsFirst or DirsLast, no matter what else we sort on.
+    if(dirsFirst || dirsLast) {
+        const bool aIsDir = entries.isDir(a);
+        const bool bIsDir = entries.isDir(b);
+        if(aIsDir != bIsDir) {
+            return dirsFirst ? aIsDir : bIsDir;
+        }
     }
 
-    // Now process the flags that should return false. If one of those flags is set and the entry matches that flag then false should be returned
-    if(m_filterFlags & QDir::NoDotAndDotDot) {
-        QString name = entry.name();
-        if(name == "." || name == "..") {
-            return false;
+    int result = 0;
+    if(m_sortFlags & QDir::Type) {
+        result = entries.rank(a, KDirectoryEntryStore::ExtensionColumn) - entries.rank(b, KDirectoryEntryStore::ExtensionColumn);
+    }
+    if(result == 0) {
+        if(sortBy == QDir::Time) {
+            const qint64 aTime = entries.timestamp(a, KDirectoryEntry::ModificationTime);
+            const qint64 bTime = entries.timestamp(b, KDirectoryEntry::ModificationTime);
+            result = (aTime < bTime) ? -1 : (aTime > bTime);
+        } else if(sortBy == QDir::Size) {
+            const KIO::filesize_t aSize = entries.size(a);
+            const KIO::filesize_t bSize = entries.size(b);
+            result = (aSize < bSize) ? -1 : (aSize > bSize);
         }
     }
+    if(result == 0 && sortBy != QDir::Unsorted) {
+        result = m_sortKeys[a].compare(m_sortKeys[b]);
+    }
+    return (m_sortFlags & QDir::Reversed) ? result > 0 : result < 0;
+}
 
-    if(m_filterFlags & QDir::NoDot) {
-        QString name = entry.name();
-        if(name == ".") {
-            return false;
+void KDirectoryPrivate::updateRows(int first)
+{
+    // Entries that aren't in m_rows (yet) have no row.
+    const int numOfEntries = m_entries->count();
+    const int oldSize = m_rowOf.count();
+    if(oldSize != numOfEntries) {
+        m_rowOf.resize(numOfEntries);
+        if(numOfEntries > oldSize) {
+            std::fill(m_rowOf.begin() + oldSize, m_rowOf.end(), -1);
         }
     }
 
-    if(m_filterFlags & QDir::NoDotDot) {
-        QString name = entry.name();
-        if(name == "..") {
-            return false;
+    const int numOfRows = m_rows.count();
+    for(int row = first; row < numOfRows; row++) {
+        m_rowOf[m_rows.at(row)] = row;
+    }
+    m_filteredEntriesCount = numOfRows;
+}
+
+// Sorts the entries at @p indexes (the ones that just came in) and merges them with the rows we already had, which
+// are already sorted. The entry store itself is never reordered, only m_rows is. Returns the rows the new entries ended up at.
+QVector<int> KDirectoryPrivate::processSortFlags(QVector<int> indexes)
+{
+    const int numOfOld = m_rows.count();
+    const int numOfNew = indexes.count();
+    QVector<int> newRows;
+    newRows.reserve(numOfNew);
+
+    if(isSorted()) {
+        // The keys are indexed like the entry store, which only grows at the end.
+        const int numOfEntries = m_entries->count();
+        for(int i = m_sortKeys.size(); i < numOfEntries; i++) {
+            m_sortKeys.push_back(m_collator.sortKey(m_entries->name(i)));
         }
+
+        // Sort only the new batch. Stable, so equal entries keep the order they came in.
+        std::stable_sort(indexes.begin(), indexes.end(), [this](int a, int b) { return lessThan(a, b); });
     }
 
-    // Hidden entries are just files/folders only starting with a "." (on *nix). If the QDir::Hidden flag is not set then it should not be shown!
-    if(entry.isHidden() && (m_filterFlags & QDir::Hidden)) {
-        return false;
+    // Without sorting, or if the whole batch comes after what we have (a listing that comes in sorted), the new rows
+    // simply go at the end.
+    if(!isSorted() || numOfOld == 0 || numOfNew == 0 || !lessThan(indexes.first(), m_rows.last())) {
+        m_rows += indexes;
+        for(int i = 0; i < numOfNew; i++) {
+            newRows.append(numOfOld + i);
+        }
+        updateRows(numOfOld);
+        return newRows;
+    }
+
+    // Merge from the back. Only the rows after the place where the first new entry goes are moved, and those are just
+    // ints. Equal entries: the ones we already had stay first.
+    m_rows.resize(numOfOld + numOfNew);
+    int from = numOfOld - 1;
+    int next = numOfNew - 1;
+    int to = numOfOld + numOfNew - 1;
+    while(next >= 0) {
+        if(from >= 0 && lessThan(indexes.at(next), m_rows.at(from))) {
+            m_rows[to] = m_rows.at(from);
+            from--;
+        } else {
+            m_rows[to] = indexes.at(next);
+            newRows.append(to);
+            next--;
+        }
+        to--;
     }
+    std::reverse(newRows.begin(), newRows.end());
+
+    updateRows(to + 1);
+    return newRows;
+}
 
-    //qDebug() << "name: " << entry.name() << "Flags:" << m_filterFlags;
+// Adds a batch to the entry store and runs the filter over it. All entries go in the store, the filter only decides
+// which of them get a row. Returns the store indexes of the entries that passed.
+QVector<int> KDirectoryPrivate::processFilterFlags(const KIO::UDSEntryList &entries)
+{
+    const bool detailsLoaded = (m_listingDetails != "0");
+    const int numOfEntries = entries.count();
+    const int first = m_entries->count();
 
-    // The following flags (if set and if the entry matches it) want to keep the current entry
-    if(m_filterFlags & QDir::Dirs && entry.isDir()) {
-        return true;
+    m_entries->reserve(numOfEntries);
+    for(const KIO::UDSEntry& entry : entries) {
+        m_entries->append(entry, detailsLoaded);
     }
 
-    if(m_filterFlags & QDir::Files && entry.isFile()) {
-        return true;
+    // The attributes of the whole batch are in the store now, run the filter over all of them in one go.
+    QVector<quint8> keep(numOfEntries);
+    const int numOfKept = m_filter.apply(m_entries->attributesData() + first, numOfEntries, keep.data());
+
+    QVector<int> kept;
+    kept.reserve(numOfKept);
+    for(int i = 0; i < numOfEntries; i++) {
+        if(keep.at(i)) {
+            kept.append(first + i);
+        }
     }
+    return kept;
+}
+
+qint64 KDirectoryPrivate::memoryUsage()
+{
+    qint64 bytes = sizeof(KDirectory) + sizeof(KDirectoryPrivate);
+    bytes += m_entries->memoryUsage();
+    bytes += qint64(m_rows.capacity() + m_rowOf.capacity()) * sizeof(int);
+    if(m_relistEntries) {
+        bytes += m_relistEntries->memoryUsage();
+    }
+
+    // A collator key is an opaque blob, QCollatorSortKey doesn't tell it's size. EstimatedSortKeyBytes is about what ICU
+    // needs for a name of 16 characters.
+    bytes += qint64(m_sortKeys.capacity()) * (sizeof(QCollatorSortKey) + EstimatedSortKeyBytes);
+
+    // Entries that came in but aren't processed yet.
+    bytes += m_pendingBytes;
+    return bytes;
+}
+
+// Applies the current filter to everything we have, no need to list again. The store has all entries, only the rows change.
+void KDirectoryPrivate::refilter()
+{
+    const int numOfEntries = m_entries->count();
+    if(numOfEntries == 0) {
+        return;
+    }
+
+    // One pass over the attribute column, spread over threads for big folders (see KDirectoryFilter::apply).
+    QVector<quint8> keep(numOfEntries);
+    m_filter.apply(m_entries->attributesData(), numOfEntries, keep.data());
 
-    if(m_filterFlags & QDir::Readable && entry.isReadable()) {
-        return true;
+    QVector<int> hide;
+    QVector<int> show;
+    for(int i = 0; i < numOfEntries; i++) {
+        const bool shown = (m_rowOf.value(i, -1) != -1);
+        if(shown && !keep.at(i)) {
+            hide.append(i);
+        } else if(!shown && keep.at(i)) {
+            show.append(i);
+        }
     }
 
-    if(m_filterFlags & QDir::Writable && entry.isWritable()) {
-        return true;
+    // First the entries that aren't shown anymore, then the ones that are. Those are sorted in like any other batch.
+    hideEntries(hide);
+    if(!show.isEmpty()) {
+        emit entriesAdded(toRanges(processSortFlags(show)));
     }
+}
 
-    if(m_filterFlags & QDir::Executable && entry.isExecutable()) {
-        return true;
+void KDirectoryPrivate::loadEntryDetails(int row)
+{
+    if(row < 0 || row >= m_filteredEntriesCount) {
+        return;
     }
 
-    if(m_filterFlags & QDir::Modified && entry.isModified()) {
-        return true;
+    // The scheduler works with the index in the entry store, that one doesn't change when the rows are sorted.
+    // It knows if this entry is already queued, being stat'ed or failed before.
+    const int id = m_rows.at(row);
+    if(!m_entries->detailsLoaded(id) && m_statScheduler.request(id, row)) {
+        scheduleStats();
     }
+}
+
+void KDirectoryPrivate::setVisibleRange(int first, int last)
+{
+    m_statScheduler.setVisibleRange(first, last);
+}
 
-    if(m_filterFlags & QDir::System && entry.isSystem()) {
-        return true;
+void KDirectoryPrivate::scheduleStats()
+{
+    // All rows a view asks for in one go (a repaint, a scroll step) are ordered by the scheduler before any of them is started.
+    if(!m_statsScheduled) {
+        m_statsScheduled = true;
+        QTimer::singleShot(0, this, SLOT(startStats()));
     }
+}
 
-    return true;
+void KDirectoryPrivate::startStats()
+{
+    m_statsScheduled = false;
+
+    const QUrl url(m_directory);
+    if(url.isLocalFile() && !m_statEngine) {
+        m_statEngine = new KStatEngine(url.toLocalFile(), this);
+        connect(m_statEngine, &KStatEngine::entriesStatted, this, &KDirectoryPrivate::slotEntriesStatted);
+        connect(m_statEngine, &KStatEngine::entriesFailed, this, &KDirectoryPrivate::slotStatFailed);
+    }
+
+    for(const int id : m_statScheduler.takeNext()) {
+        // The engine stats all of these together instead of one job per file.
+        if(m_statEngine && m_statEngine->isValid()) {
+            m_statEngine->request(m_entries->name(id));
+        } else {
+            startStatJob(id);
+        }
+    }
 }
 
-void KDirectoryPrivate::processSortFlags()
+void KDirectoryPrivate::startStatJob(int id)
 {
-    // If we have no sort filter, abort!
-    if(m_sortFlags == QDir::NoSort) {
+    QUrl newUrl = QUrl(m_directory + QDir::separator() + m_entries->at(id).name());
+
+    KIO::StatJob* sjob = KIO::stat(newUrl, KIO::HideProgressInfo);
+    sjob->setUiDelegate(0);
+
+    // Entries can be removed while the stat is running (KDirWatch), so the name is what identifies the entry.
+    sjob->setProperty("name", m_entries->name(id));
+
+    // The cache can delete us while stats are running, those are killed in our destructor.
+    m_statJobs.insert(sjob);
+    connect(sjob, &KIO::StatJob::result, this, [&](KJob* job){
+        m_statJobs.remove(job);
+        KIO::StatJob* statJob = qobject_cast<KIO::StatJob*>(job);
+        const int id = m_entries->indexOf(statJob->property("name").toString());
+
+        if(statJob->error()) {
+            // failed to stat this file..
+            qDebug() << "Failed to stat the file:" << statJob->url();
+            m_statScheduler.finished(id, false);
+        } else {
+            m_statScheduler.finished(id, true);
+
+            // Removed in the meantime?
+            if(id != -1) {
+                m_entries->update(id, statJob->statResult(), true);
+                detailsChanged(id);
+            }
+        }
+
+        if(m_statScheduler.hasPending()) {
+            scheduleStats();
+        }
+    });
+}
+
+void KDirectoryPrivate::slotEntries(KIO::Job *, const KIO::UDSEntryList &entries)
+{
+    queueEntries(entries);
+}
+
+void KDirectoryPrivate::queueEntries(const KIO::UDSEntryList &entries)
+{
+    if(m_cancelled) {
         return;
     }
 
-    if(m_sortFlags & QDir::DirsFirst) {
-        // TODO: restructure this.
-    } else if(m_sortFlags & QDir::DirsLast) {
-        // TODO: restructure this.
-    } else {
-        // TODO: restructure this.
+    m_pendingBatches.enqueue(entries);
+    m_pendingBytes += qint64(entries.count()) * EstimatedEntryBytes;
+
+    // We can't keep up. Stop the listing until we're through most of what we have, otherwise a big folder that is
+    // listed in the background can eat all memory and keep the event loop busy for the folder the user looks at.
+    if(m_pendingBytes > MaxPendingBytes) {
+        suspendListing(Backpressure);
     }
+
+    scheduleIngest();
 }
 
-// This filter just creates a new list with the entries that we are interested in.
-void KDirectoryPrivate::processFilterFlags(const KIO::UDSEntryList &entries)
+void KDirectoryPrivate::scheduleIngest()
 {
-    // Move the entries that we want to use to a new list. The remaining entries that we
-    // - for whatever reason - don't use move to m_unusedEntries.
+    if(!m_ingestScheduled) {
+        m_ingestScheduled = true;
+        QTimer::singleShot(0, this, SLOT(ingestEntries()));
+    }
+}
+
+void KDirectoryPrivate::ingestEntries()
+{
+    m_ingestScheduled = false;
+    if(m_cancelled) {
+        return;
+    }
 
-    for(const KIO::UDSEntry entry : entries) {
-        KDirectoryEntry e(entry, m_details);
-        if(keepEntryAccordingToFilter(e)) {
-            m_filteredEntries.append(e); // Move the item to m_usableEntries
+    // Only take what the batch policy allows per event loop iteration so other folders (and the view) get their turn.
+    // That doesn't have to match the batches the listing sends, so those get split when needed.
+    const int batchSize = m_batchPolicy.batchSize();
+    KIO::UDSEntryList entries;
+    while(!m_pendingBatches.isEmpty() && entries.count() < batchSize) {
+        const int needed = batchSize - entries.count();
+        if(m_pendingBatches.head().count() <= needed) {
+            entries.append(m_pendingBatches.dequeue());
         } else {
-            m_unusedEntries.append(e); // Hidden entries or for whatever reason not being used.
+            KIO::UDSEntryList& head = m_pendingBatches.head();
+            entries.append(head.mid(0, needed));
+            head = head.mid(needed);
         }
     }
-    m_filteredEntriesCount = m_filteredEntries.count();
+    m_pendingBytes -= qint64(entries.count()) * EstimatedEntryBytes;
+
+    if(!entries.isEmpty()) {
+        QElapsedTimer timer;
+        timer.start();
+        processEntries(entries);
+        m_batchPolicy.batchProcessed(entries.count(), timer.nsecsElapsed());
+    }
+
+    if((m_suspendReasons & Backpressure) && m_pendingBytes <= MaxPendingBytes / 2) {
+        resumeListing(Backpressure);
+    }
+
+    if(!m_pendingBatches.isEmpty()) {
+        scheduleIngest();
+    } else if(m_resultPending) {
+        m_resultPending = false;
+        if(!m_listingFailed) {
+            saveSnapshot();
+        }
+        listingCompleted();
+    }
 }
 
-void KDirectoryPrivate::loadEntryDetails(int id)
+void KDirectoryPrivate::suspendListing(SuspendReason reason)
 {
-    // Prevent needless stat calls when a stat call for the requested file is currently in progress.
-    if(m_statInProgress.contains(id)) {
+    // The listing only runs when nobody wants it suspended, so only the first reason suspends it.
+    const bool suspended = m_suspendReasons;
+    m_suspendReasons |= reason;
+    if(suspended) {
         return;
     }
 
-    // If we end up here then details are fetched with an id that isn't in out m_statInProgress list yet.
-    m_statInProgress.append(id);
+    if(m_job) {
+        m_job->suspend();
+    } else if(m_localLister) {
+        m_localLister->suspend();
+    }
+}
+
+void KDirectoryPrivate::resumeListing(SuspendReason reason)
+{
+    if(!(m_suspendReasons & reason)) {
+        return;
+    }
 
-    if(id >= 0 && id < m_filteredEntriesCount) {
-        QUrl newUrl = QUrl(m_directory + QDir::separator() + m_filteredEntries.at(id).name());
+    m_suspendReasons &= ~reason;
+    if(m_suspendReasons) {
+        return;
+    }
 
-        KIO::StatJob* sjob = KIO::stat(newUrl, KIO::HideProgressInfo);
-        sjob->setUiDelegate(0);
-        sjob->setProperty("id", id);
-        connect(sjob, &KIO::StatJob::result, [&](KJob* job){
-            KIO::StatJob* statJob = qobject_cast<KIO::StatJob*>(job);
-            if(statJob->error()) {
-                // failed to stat this file..
-                qDebug() << "Failed to stat the file:" << statJob->url();
-            } else {
-//                qDebug() << "Failed to stat the file:" << statJob->url() << "id:" << statJob->property("id").toInt();
-                int id = statJob->property("id").toInt();
-                m_filteredEntries[id].setUDSEntry(statJob->statResult(), "2");
-                if(m_filteredEntries[id].detailsLoaded()) {
-                    emit entryDetailsChanged(id);
-                } else {
-                    qDebug() << "Details where loaded, but failed to actually set in the KDirectoryEntry object.";
-                }
-
-                // Remove the id from m_statInProgress since we're now done stat calling this file.
-                m_statInProgress.removeOne(id);
-            }
-        });
+    if(m_job) {
+        m_job->resume();
+    } else if(m_localLister) {
+        m_localLister->resume();
     }
 }
 
-void KDirectoryPrivate::slotEntries(KIO::Job *, const KIO::UDSEntryList &entries)
+void KDirectoryPrivate::cancelListing()
+{
+    if(m_completed || m_cancelled) {
+        return;
+    }
+
+    // Results of the lister can already be queued for us. Those are ignored from here on (m_cancelled), a cancelled
+    // listing never completes.
+    m_cancelled = true;
+    if(m_job) {
+        disconnect(m_job, 0, this, 0);
+        m_job->kill();
+        m_job = 0;
+    }
+    if(m_localLister) {
+        disconnect(m_localLister, 0, this, 0);
+        delete m_localLister;
+        m_localLister = 0;
+    }
+
+    m_pendingBatches.clear();
+    m_pendingBytes = 0;
+    m_resultPending = false;
+    m_upgradePending = false;
+    m_suspendReasons = 0;
+}
+
+void KDirectoryPrivate::processEntries(const KIO::UDSEntryList &entries)
 {
     if(entries.count() > 0) {
 
 //        qDebug() << "Entries received:" << entries.count();
 
         // Apply filters. Count just so that we filter the last # of entries that we received though this function
-        processFilterFlags(entries);
+        const int numOfRows = m_filteredEntriesCount;
+        const QVector<int> kept = processFilterFlags(entries);
 
-        // Apply the sorting filters
-        processSortFlags();
+        // Apply the sorting filters. If new entries ended up in between the ones we already had, the usual "more entries
+        // at the end" isn't true anymore so we tell exactly where they went.
+        const QVector<int> newRows = processSortFlags(kept);
+        if(!newRows.isEmpty() && newRows.first() < numOfRows) {
+            emit entriesAdded(toRanges(newRows));
+        }
 
         emit entriesProcessed();
     } else {
@@ -251,12 +679,662 @@ void KDirectoryPrivate::slotEntries(KIO::Job *, const KIO::UDSEntryList &entries
 //    qDebug() << "Entries! Count with filter:" << m_allEntries.count() << "count without filter:" << entries.count();
 }
 
-void KDirectoryPrivate::slotResult(KJob *)
+void KDirectoryPrivate::slotResult(KJob *job)
+{
+    if(m_cancelled) {
+        return;
+    }
+    m_job = 0;
+    m_listingFailed = job->error();
+
+    // The entries that are still queued come first.
+    m_resultPending = true;
+    scheduleIngest();
+}
+
+void KDirectoryPrivate::slotLocalResult(int error)
+{
+    if(m_cancelled) {
+        return;
+    }
+    if(error) {
+        qDebug() << "Failed to list:" << m_directory << "error:" << error;
+    }
+    m_listingFailed = error;
+
+    // The entries that are still queued come first.
+    m_resultPending = true;
+    scheduleIngest();
+}
+
+void KDirectoryPrivate::slotEntriesStatted(const KIO::UDSEntryList &entries)
+{
+    for(const KIO::UDSEntry& entry : entries) {
+        // Entries can be removed or moved while the batch was running, the name is what identifies them.
+        const int id = m_entries->indexOf(entry.stringValue(KIO::UDSEntry::UDS_NAME));
+        m_statScheduler.finished(id, true);
+        if(id == -1) {
+            continue;
+        }
+
+        m_entries->update(id, entry, true);
+        detailsChanged(id);
+    }
+
+    if(m_statScheduler.hasPending()) {
+        scheduleStats();
+    }
+}
+
+void KDirectoryPrivate::slotStatFailed(const QStringList &names)
+{
+    qDebug() << "Failed to stat" << names.count() << "files in:" << m_directory;
+
+    // The scheduler remembers these, no point in trying again and again.
+    for(const QString& name : names) {
+        m_statScheduler.finished(m_entries->indexOf(name), false);
+    }
+
+    if(m_statScheduler.hasPending()) {
+        scheduleStats();
+    }
+}
+
+void KDirectoryPrivate::detailsChanged(int id)
+{
+    m_changedDetails.append(id);
+    if(!m_detailsChangedTimer.isActive()) {
+        m_detailsChangedTimer.start();
+    }
+}
+
+void KDirectoryPrivate::flushDetailsChanged()
+{
+    m_detailsChangedTimer.stop();
+    if(m_changedDetails.isEmpty()) {
+        return;
+    }
+
+    // These are ids in the entry store, the outside knows rows. Stat results come back in any order and an entry can be
+    // in here more then once (reloaded after a change).
+    QVector<int> rows;
+    rows.reserve(m_changedDetails.count());
+    for(const int id : m_changedDetails) {
+        const int row = m_rowOf.value(id, -1);
+        if(row != -1) {
+            rows.append(row);
+        }
+    }
+    m_changedDetails.clear();
+    if(rows.isEmpty()) {
+        return;
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    emit entriesDetailsChanged(toRanges(rows));
+}
+
+void KDirectoryPrivate::upgradeDetails()
+{
+    // The entries that are still to come don't have details either. Merging only makes sense once we have them all.
+    if(!m_completed) {
+        m_upgradePending = true;
+        return;
+    }
+    if(m_upgradeLister || m_upgradeJob) {
+        return;
+    }
+
+    // A second listing, this time with details, merged into what we have by name. For local folders that is a stat per entry
+    // on a worker thread, for anything else one list job instead of a stat job per entry.
+    const QUrl url(m_directory);
+    if(url.isLocalFile() && KLocalDirLister::canList(url.toLocalFile())) {
+        m_upgradeLister = new KLocalDirLister(url.toLocalFile(), m_details, m_recursive, this);
+        connect(m_upgradeLister, &KLocalDirLister::entries, this, &KDirectoryPrivate::mergeDetails);
+        connect(m_upgradeLister, &KLocalDirLister::result, this, [&](int error){
+            m_upgradeLister->deleteLater();
+            m_upgradeLister = 0;
+            upgradeCompleted(!error);
+        });
+        m_upgradeLister->start();
+        return;
+    }
+
+    m_upgradeJob = m_recursive ? KIO::listRecursive(url, KIO::HideProgressInfo, true) : KIO::listDir(url, KIO::HideProgressInfo);
+    m_upgradeJob->setUiDelegate(0);
+    m_upgradeJob->addMetaData("details", m_details);
+    connect(m_upgradeJob, &KIO::ListJob::entries, this, [&](KIO::Job*, const KIO::UDSEntryList& entries){
+        mergeDetails(entries);
+    });
+    connect(m_upgradeJob, &KJob::result, this, [&](KJob* job){
+        m_upgradeJob = 0;
+        upgradeCompleted(!job->error());
+    });
+}
+
+void KDirectoryPrivate::upgradeCompleted(bool ok)
+{
+    // From now on what we have is a listing with details. The snapshot is saved as one, the names only snapshot
+    // stays for whoever lists without details.
+    if(ok) {
+        m_listingDetails = m_details;
+        saveSnapshot();
+    }
+}
+
+void KDirectoryPrivate::mergeDetails(const KIO::UDSEntryList &entries)
+{
+    QVector<int> merged;
+    QVector<int> hide;
+    QVector<int> show;
+    for(const KIO::UDSEntry& entry : entries) {
+        const QString name = entry.stringValue(KIO::UDSEntry::UDS_NAME);
+
+        // Names and positions stay as they are. Entries that are new since the first listing are left to KDirWatch.
+        // The fingerprint is taken over as well. Relists run with the new details, their fingerprints have to match these.
+        const int id = m_entries->indexOf(name);
+        if(id == -1) {
+            continue;
+        }
+
+        const bool hadDetails = m_entries->detailsLoaded(id);
+        m_entries->replace(id, entry, true);
+        if(!hadDetails) {
+            detailsChanged(id);
+        }
+
+        // Readable, Writable and NoSymLinks only really work with details, so this can change what passes the filter.
+        const bool shown = (m_rowOf.value(id, -1) != -1);
+        const bool keep = m_filter.matches(m_entries->attributes(id));
+        if(shown && !keep) {
+            hide.append(id);
+        } else if(!shown && keep) {
+            show.append(id);
+        } else if(shown && !hadDetails) {
+            merged.append(id);
+        }
+    }
+
+    // Sorted on size or time the rows that just got their details are in the wrong place.
+    resortEntries(merged);
+    std::sort(hide.begin(), hide.end());
+    hideEntries(hide);
+    if(!show.isEmpty()) {
+        emit entriesAdded(toRanges(processSortFlags(show)));
+    }
+}
+
+bool KDirectoryPrivate::loadSnapshot()
 {
-    qDebug() << "Filtered entries:" << m_filteredEntries.count();
-    qDebug() << "Unused entries:" << m_unusedEntries.count();
+    KDirectorySnapshot snapshot(m_directory, m_listingDetails, m_filter.filters(), m_sortFlags, m_recursive);
+    QExplicitlySharedDataPointer<KDirectoryEntryStore> entries(new KDirectoryEntryStore());
+    KDirectoryEntryStore unused;
+    if(!snapshot.load(entries.data(), &unused)) {
+        return false;
+    }
+
+    // The snapshot has the filtered entries in sorted order, so every one of those is at its own row. The others go
+    // after them without a row. The sort keys are made again once new entries need to be merged in.
+    const int numOfRows = entries->count();
+    entries->reserve(unused.count());
+    for(int i = 0; i < unused.count(); i++) {
+        entries->append(unused, i);
+    }
+    m_entries = entries;
+    m_rows.resize(numOfRows);
+    std::iota(m_rows.begin(), m_rows.end(), 0);
+    m_rowOf.clear();
+    updateRows(0);
+    m_sortKeys.clear();
+    emit entriesProcessed();
+    listingCompleted();
+
+    // Show what we had first, then make sure it's still right. A relist only reports the differences.
+    if(!snapshot.isCurrent()) {
+        relist();
+    }
+    return true;
+}
+
+void KDirectoryPrivate::saveSnapshot()
+{
+    const QUrl url(m_directory);
+    if(!m_snapshotsEnabled || !url.isLocalFile()) {
+        return;
+    }
+
+    // Snapshots have the filtered entries in sorted order, loading them doesn't need to sort again.
+    KDirectoryEntryStore sorted;
+    sorted.reserve(m_rows.count());
+    for(const int id : m_rows) {
+        sorted.append(*m_entries, id);
+    }
+    KDirectoryEntryStore unused;
+    unused.reserve(m_entries->count() - m_rows.count());
+    for(int i = 0; i < m_entries->count(); i++) {
+        if(m_rowOf.value(i, -1) == -1) {
+            unused.append(*m_entries, i);
+        }
+    }
+
+    KDirectorySnapshot snapshot(m_directory, m_listingDetails, m_filter.filters(), m_sortFlags, m_recursive);
+    if(!snapshot.save(m_listingState, sorted, unused)) {
+        qDebug() << "Failed to write snapshot:" << snapshot.fileName();
+    }
+}
+
+void KDirectoryPrivate::listingCompleted()
+{
+    qDebug() << "Filtered entries:" << m_filteredEntriesCount;
+    qDebug() << "Unused entries:" << m_entries->count() - m_filteredEntriesCount;
+
+    if(m_cancelled) {
+        return;
+    }
+    m_completed = true;
+
+    // Details where asked for while we where still listing without them.
+    if(m_upgradePending) {
+        m_upgradePending = false;
+        upgradeDetails();
+    }
 
     // Thought: since we're emitting it directly, perhaps just remove this slot completely and emit the signal from KDirListerV2?
     emit completed();
 
+    // From now on we follow the changes in this directory.
+    startWatching();
+}
+
+void KDirectoryPrivate::startWatching()
+{
+    // KDirWatch only works on local folders.
+    const QUrl url(m_directory);
+    if(!m_watchedPath.isEmpty() || !url.isLocalFile()) {
+        return;
+    }
+
+    m_watchedPath = url.toLocalFile();
+    while(m_watchedPath.length() > 1 && m_watchedPath.endsWith(QLatin1Char('/'))) {
+        m_watchedPath.chop(1);
+    }
+
+    // m_watch is ours, it only emits for this folder and the files in it.
+    m_watch->addDir(m_watchedPath, KDirWatch::WatchFiles);
+    connect(m_watch, &KDirWatch::dirty, this, &KDirectoryPrivate::slotDirty);
+    connect(m_watch, &KDirWatch::created, this, &KDirectoryPrivate::slotCreated);
+    connect(m_watch, &KDirWatch::deleted, this, &KDirectoryPrivate::slotDeleted);
+}
+
+void KDirectoryPrivate::slotDirty(const QString &path)
+{
+    if(path == m_watchedPath) {
+        // Something in the folder changed. Backends that watch files tell us what as well, see flushWatchEvents.
+        m_folderDirty = true;
+    } else if(QFileInfo(path).path() == m_watchedPath) {
+        // One file changed, only that one needs to be looked at.
+        const QString name = QFileInfo(path).fileName();
+        m_deletedNames.remove(name);
+        m_dirtyNames.insert(name);
+    } else {
+        return;
+    }
+
+    // Not restarted on every event, a folder that keeps changing still gets updated.
+    if(!m_watchTimer.isActive()) {
+        m_watchTimer.start();
+    }
+}
+
+void KDirectoryPrivate::slotCreated(const QString &path)
+{
+    if(QFileInfo(path).path() == m_watchedPath) {
+        const QString name = QFileInfo(path).fileName();
+        m_deletedNames.remove(name);
+        m_dirtyNames.insert(name);
+        if(!m_watchTimer.isActive()) {
+            m_watchTimer.start();
+        }
+    }
+}
+
+void KDirectoryPrivate::slotDeleted(const QString &path)
+{
+    if(path == m_watchedPath) {
+        // The folder itself is gone, and with it all entries.
+        m_watchTimer.stop();
+        m_dirtyNames.clear();
+        m_deletedNames.clear();
+        m_folderDirty = false;
+
+        QVector<int> all(m_entries->count());
+        std::iota(all.begin(), all.end(), 0);
+        removeEntries(all);
+    } else if(QFileInfo(path).path() == m_watchedPath) {
+        const QString name = QFileInfo(path).fileName();
+        m_dirtyNames.remove(name);
+        m_deletedNames.insert(name);
+        if(!m_watchTimer.isActive()) {
+            m_watchTimer.start();
+        }
+    }
+}
+
+void KDirectoryPrivate::flushWatchEvents()
+{
+    // All deleted entries go in one go, removing is O(n) no matter how many.
+    QVector<int> removed;
+    for(const QString& name : m_deletedNames) {
+        const int index = m_entries->indexOf(name);
+        if(index != -1) {
+            removed.append(index);
+        }
+    }
+    std::sort(removed.begin(), removed.end());
+    removeEntries(removed);
+
+    // Only the names that changed are stat'ed. A changed folder without any names means the backend doesn't watch
+    // files, then the only way to find out is reading the folder again.
+    if(!m_dirtyNames.isEmpty()) {
+        for(const QString& name : m_dirtyNames) {
+            statPath(m_watchedPath + QLatin1Char('/') + name);
+        }
+    } else if(m_folderDirty && m_deletedNames.isEmpty()) {
+        relist();
+    }
+
+    m_dirtyNames.clear();
+    m_deletedNames.clear();
+    m_folderDirty = false;
+}
+
+void KDirectoryPrivate::reload()
+{
+    // A listing that is still running is as fresh as it gets. The first listing saves a snapshot and starts watching
+    // once it's done, a reload after that is just a relist. completed is emitted again once the differences are applied.
+    if(!m_completed) {
+        return;
+    }
+
+    m_reloading = true;
+    relist();
+}
+
+void KDirectoryPrivate::relist()
+{
+    // Don't pile up jobs when changes come in quickly. One more relist after the current one is enough.
+    if(m_relistJob) {
+        m_relistPending = true;
+        return;
+    }
+
+    m_relistEntries = new KDirectoryEntryStore();
+    if(m_snapshotsEnabled) {
+        m_listingState = KDirectorySnapshot::folderState(QUrl(m_directory).toLocalFile());
+    }
+    m_relistJob = m_recursive ? KIO::listRecursive(QUrl(m_directory), KIO::HideProgressInfo, true) : KIO::listDir(QUrl(m_directory), KIO::HideProgressInfo);
+    m_relistJob->setUiDelegate(0);
+    if(!m_details.isEmpty()) {
+        m_relistJob->addMetaData("details", m_details);
+    }
+
+    connect(m_relistJob, &KIO::ListJob::entries, this, [&](KIO::Job*, const KIO::UDSEntryList& entries){
+        const bool detailsLoaded = (m_details != "0");
+        m_relistEntries->reserve(entries.count());
+        for(const KIO::UDSEntry& entry : entries) {
+            m_relistEntries->append(entry, detailsLoaded);
+        }
+    });
+
+    connect(m_relistJob, &KJob::result, this, [&](KJob* job){
+        m_relistJob = 0;
+        if(job->error()) {
+            qDebug() << "Failed to relist:" << m_directory << job->errorString();
+        } else {
+            applyRelist(*m_relistEntries);
+            saveSnapshot();
+        }
+        m_relistEntries.reset();
+
+        if(m_relistPending) {
+            m_relistPending = false;
+            relist();
+        } else if(m_reloading) {
+            m_reloading = false;
+            emit completed();
+        }
+    });
+}
+
+void KDirectoryPrivate::statPath(const QString &path)
+{
+    KIO::StatJob* sjob = KIO::stat(QUrl::fromLocalFile(path), KIO::HideProgressInfo);
+    sjob->setUiDelegate(0);
+    sjob->setProperty("name", QFileInfo(path).fileName());
+
+    // We might be gone before the stat is, the job is killed in our destructor then.
+    m_statJobs.insert(sjob);
+    connect(sjob, &KIO::StatJob::result, this, [&](KJob* job){
+        m_statJobs.remove(job);
+        KIO::StatJob* statJob = qobject_cast<KIO::StatJob*>(job);
+        if(statJob->error()) {
+            // Most likely removed again before we got to it. The deleted signal takes care of that.
+            return;
+        }
+
+        // Stat returns the name as it was asked for. Make sure it's just the file name like in a listing.
+        KIO::UDSEntry entry = statJob->statResult();
+        entry.insert(KIO::UDSEntry::UDS_NAME, statJob->property("name").toString());
+        applyEntry(entry);
+    });
+}
+
+void KDirectoryPrivate::applyRelist(const KDirectoryEntryStore &listing)
+{
+    // The store and the listing both have all entries. The store is updated in place so that unchanged entries keep their index.
+    const KDirectoryEntryStore::Diff diff = KDirectoryEntryStore::diff(*m_entries, listing);
+
+    // Changed entries first, their indexes are those of the current store. The outside knows them by row. A change can
+    // make an entry pass the filter or not anymore.
+    QVector<int> changed;
+    QVector<int> hide;
+    QVector<int> show;
+    for(const QPair<int, int>& change : diff.changed) {
+        const int id = change.first;
+        m_entries->replace(id, listing, change.second);
+        m_statScheduler.forget(id);
+
+        const int row = m_rowOf.value(id, -1);
+        const bool keep = m_filter.matches(m_entries->attributes(id));
+        if(row != -1 && keep) {
+            changed.append(row);
+        } else if(row != -1) {
+            hide.append(id);
+        } else if(keep) {
+            show.append(id);
+        }
+    }
+    if(!changed.isEmpty()) {
+        std::sort(changed.begin(), changed.end());
+        emit entriesChanged(toRanges(changed));
+
+        QVector<int> ids;
+        ids.reserve(changed.count());
+        for(const int row : changed) {
+            ids.append(m_rows.at(row));
+        }
+        resortEntries(ids);
+    }
+    std::sort(hide.begin(), hide.end());
+    hideEntries(hide);
+
+    // New entries go at the end of the store, and to the rows where they belong if they pass the filter.
+    for(const int i : diff.added) {
+        const int id = m_entries->append(listing, i);
+        if(m_filter.matches(m_entries->attributes(id))) {
+            show.append(id);
+        }
+    }
+    if(!show.isEmpty()) {
+        emit entriesAdded(toRanges(processSortFlags(show)));
+    }
+
+    // Last, those don't change the indexes of what is above.
+    removeEntries(diff.removed);
+}
+
+void KDirectoryPrivate::applyEntry(const KIO::UDSEntry &entry)
+{
+    const QString name = entry.stringValue(KIO::UDSEntry::UDS_NAME);
+    const bool keep = m_filter.matches(KDirectoryEntryStore::attributes(entry, true));
+
+    const int index = m_entries->indexOf(name);
+    if(index == -1) {
+        const int newIndex = m_entries->append(entry, true);
+        if(keep) {
+            emit entriesAdded(toRanges(processSortFlags(QVector<int>() << newIndex)));
+        }
+        return;
+    }
+
+    if(m_entries->fingerprint(index) == KDirectoryEntryStore::fingerprint(entry)) {
+        return;
+    }
+    m_entries->replace(index, entry, true);
+    m_statScheduler.forget(index);
+
+    // Changed, possibly in a way that it does or doesn't pass the filter anymore.
+    const int row = m_rowOf.value(index, -1);
+    if(row != -1 && keep) {
+        emit entriesChanged(KDirectoryRanges() << KDirectoryRange(row, row));
+        resortEntries(QVector<int>() << index);
+    } else if(row != -1) {
+        hideEntries(QVector<int>() << index);
+    } else if(keep) {
+        emit entriesAdded(toRanges(processSortFlags(QVector<int>() << index)));
+    }
+}
+
+void KDirectoryPrivate::hideEntries(const QVector<int> &indexes)
+{
+    // The rows of these entries, that is what the outside knows them by. Entries that are hidden already don't have one.
+    QVector<int> rows;
+    rows.reserve(indexes.count());
+    for(const int i : indexes) {
+        const int row = m_rowOf.value(i, -1);
+        if(row != -1) {
+            rows.append(row);
+        }
+    }
+    if(rows.isEmpty()) {
+        return;
+    }
+    std::sort(rows.begin(), rows.end());
+
+    // The other rows keep their order and move up. The entries themselves stay in the store.
+    QVector<int> keptRows;
+    keptRows.reserve(m_rows.count() - rows.count());
+    int next = 0;
+    for(int row = 0; row < m_rows.count(); row++) {
+        if(next < rows.count() && rows.at(next) == row) {
+            m_rowOf[m_rows.at(row)] = -1;
+            next++;
+        } else {
+            keptRows.append(m_rows.at(row));
+        }
+    }
+    m_rows.swap(keptRows);
+    updateRows(rows.first());
+
+    emit entriesRemoved(toRanges(rows));
+}
+
+void KDirectoryPrivate::resortEntries(const QVector<int> &indexes)
+{
+    if(!isSorted()) {
+        return;
+    }
+
+    // Entries that are still between their neighbours stay where they are, the others are taken out and sorted
+    // in again. The names don't change, so the sort keys are still right.
+    QVector<int> misplaced;
+    const int numOfRows = m_rows.count();
+    for(const int id : indexes) {
+        const int row = m_rowOf.value(id, -1);
+        if(row == -1) {
+            continue;
+        }
+        if((row > 0 && lessThan(id, m_rows.at(row - 1))) || (row + 1 < numOfRows && lessThan(m_rows.at(row + 1), id))) {
+            misplaced.append(id);
+        }
+    }
+    if(misplaced.isEmpty()) {
+        return;
+    }
+
+    std::sort(misplaced.begin(), misplaced.end());
+    hideEntries(misplaced);
+    emit entriesAdded(toRanges(processSortFlags(misplaced)));
+}
+
+void KDirectoryPrivate::removeEntries(const QVector<int> &indexes)
+{
+    if(indexes.isEmpty()) {
+        return;
+    }
+
+    // Changed details that are waiting to be reported use the current ids, get rid of those first.
+    flushDetailsChanged();
+    hideEntries(indexes);
+
+    // In place, entries that are still out there (KDirectoryEntry objects) are live views.
+    m_entries->remove(indexes);
+
+    // The ids after the removed ones shift down by the number of removed ids before them.
+    QVector<int> newIds(m_rowOf.count());
+    int removed = 0;
+    for(int i = 0; i < newIds.count(); i++) {
+        if(removed < indexes.count() && indexes.at(removed) == i) {
+            removed++;
+            newIds[i] = -1;
+        } else {
+            newIds[i] = i - removed;
+        }
+    }
+    for(int& id : m_rows) {
+        id = newIds.at(id);
+    }
+    m_rowOf.clear();
+    updateRows(0);
+
+    if(!m_sortKeys.empty()) {
+        std::vector<QCollatorSortKey> sortKeys;
+        sortKeys.reserve(m_entries->count());
+        int next = 0;
+        for(int i = 0; i < static_cast<int>(m_sortKeys.size()); i++) {
+            if(next < indexes.count() && indexes.at(next) == i) {
+                next++;
+            } else {
+                sortKeys.push_back(m_sortKeys[i]);
+            }
+        }
+        m_sortKeys.swap(sortKeys);
+    }
+
+    // The ids the stat scheduler knows about moved. Running stats find their entry by name.
+    m_statScheduler.remove(indexes);
+}
+
+KDirectoryRanges KDirectoryPrivate::toRanges(const QVector<int> &indexes)
+{
+    KDirectoryRanges ranges;
+    for(const int i : indexes) {
+        if(!ranges.isEmpty() && ranges.last().last + 1 == i) {
+            ranges.last().last = i;
+        } else {
+            ranges.append(KDirectoryRange(i, i));
+        }
+    }
+    return ranges;
 }
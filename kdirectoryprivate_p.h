@@ -4,33 +4,94 @@
 #include <QObject>
 #include <QDir>
 #include <QVector>
+#include <QCollator>
+#include <QCollatorSortKey>
+#include <QTimer>
+#include <QQueue>
+#include <QSet>
+
+#include <vector>
 
 // KDE includes
 #include <KDirWatch>
 #include <KIO/Job>
 
 #include "kdirectoryentry.h"
+#include "kdirectoryentrystore.h"
+#include "kdirectoryfilter.h"
+#include "kdirectorybatchpolicy.h"
+#include "kdirectorysnapshot.h"
 #include "kdirectory.h"
+#include "klocaldirlister_p.h"
+#include "kstatengine_p.h"
+#include "kstatscheduler_p.h"
 
 
 class KDirectoryPrivate : public QObject
 {
     Q_OBJECT
 public:
+    // One frame at 60 fps.
+    enum { DefaultDetailsChangedInterval = 16 };
+
+    // KDirWatch events come in bursts (a copy, an unpack), they are collected this long before they are applied.
+    enum { DefaultWatchInterval = 100 };
+
+    // Backpressure: the listing is suspended once more then MaxPendingBytes (a rough estimate, EstimatedEntryBytes
+    // per entry) is waiting to be processed. How much is processed per event loop iteration is up to m_batchPolicy.
+    enum { MaxPendingBytes = 32 * 1024 * 1024, EstimatedEntryBytes = 512 };
+
+    // Rough size of one collator key, see memoryUsage.
+    enum { EstimatedSortKeyBytes = 48 };
+
+    // Why the listing is suspended: we can't keep up with processing, or KListingScheduler lets something more important go first.
+    enum SuspendReason { Backpressure = 0x1, Scheduler = 0x2 };
+
     explicit KDirectoryPrivate(KDirectory* dir, const QString& directory);
+    ~KDirectoryPrivate();
     void setDetails(const QString& details);
-    const KDirectoryEntry& entry(int index);
+    KDirectoryEntry entry(int index);
     
     QDir::Filters filter();
     void setFilter(QDir::Filters filters);
     QDir::SortFlags sorting();
     void setSorting(QDir::SortFlags sort);
 
-    bool keepEntryAccordingToFilter(KDirectoryEntry entry);
-    void processSortFlags();
-    void processFilterFlags(const KIO::UDSEntryList &entries);
-
-    void loadEntryDetails(int id);
+    bool isSorted() const;
+    bool lessThan(int a, int b) const;
+    void updateRows(int first);
+    QVector<int> processSortFlags(QVector<int> indexes);
+    QVector<int> processFilterFlags(const KIO::UDSEntryList &entries);
+    void queueEntries(const KIO::UDSEntryList &entries);
+    void scheduleIngest();
+    void suspendListing(SuspendReason reason);
+    void resumeListing(SuspendReason reason);
+    void cancelListing();
+    bool loadSnapshot();
+    void upgradeDetails();
+    void mergeDetails(const KIO::UDSEntryList& entries);
+    void upgradeCompleted(bool ok);
+    void saveSnapshot();
+    void refilter();
+    qint64 memoryUsage();
+
+    void loadEntryDetails(int row);
+    void setVisibleRange(int first, int last);
+    void scheduleStats();
+    void startStatJob(int id);
+    void detailsChanged(int id);
+
+    // Live updates. The directory is added to KDirWatch once the first listing is done.
+    void startWatching();
+    void reload();
+    void relist();
+    void statPath(const QString& path);
+    void applyRelist(const KDirectoryEntryStore& listing);
+    void applyEntry(const KIO::UDSEntry& entry);
+    void hideEntries(const QVector<int>& indexes);
+    void resortEntries(const QVector<int>& indexes);
+    void removeEntries(const QVector<int>& indexes);
+    static KDirectoryRanges toRanges(const QVector<int>& indexes);
 
     // Pointer to the actual KDirectory object.
     KDirectory* q;
@@ -40,32 +101,130 @@ public:
     // <protocol>://<path>
     QString m_directory;
 
-    // A list of all entries in this directory.
-    QVector<KDirectoryEntry> m_filteredEntries;
+    // A list of all entries in this directory, also the ones that don't pass the filter. The store is shared
+    // with the KDirectoryEntry objects we hand out, it is freed when we and the last entry pointing into it
+    // are gone. We always change it in place, never detach. Those entries are live views, see KDirectoryEntry.
+    QExplicitlySharedDataPointer<KDirectoryEntryStore> m_entries;
+
+    // The store only grows at the end (or shrinks when entries are removed), it isn't sorted or filtered. m_rows
+    // is: row i shows store entry m_rows[i]. m_rowOf goes the other way, the row of a store entry or -1 if the
+    // filter hides it. See processSortFlags and refilter.
+    QVector<int> m_rows;
+    QVector<int> m_rowOf;
     int m_filteredEntriesCount;
-    QVector<KDirectoryEntry> m_unusedEntries;
-    KDirectoryEntry m_emptyEntry;
-    KDirectoryEntry m_lastEntry;
-    int m_lastEntryId;
-    QList<int> m_statInProgress;
+    KStatScheduler m_statScheduler;
+    bool m_statsScheduled;
+
+    // Ids with newly loaded details that haven't been reported yet, see flushDetailsChanged.
+    QVector<int> m_changedDetails;
+    QTimer m_detailsChangedTimer;
 
     KIO::ListJob * m_job;
 
+    // Local folders are listed without KIO, see KLocalDirLister.
+    KLocalDirLister* m_localLister;
+
+    // Number of users (models) of this directory, see KDirectory::ref().
+    int m_refCount;
+
+    // A listing ends either completed or cancelled (see cancelListing), never both.
+    bool m_completed;
+    bool m_cancelled;
+
+    // See KDirectory::setDeferredStart. The listing starts only once, the first time it's asked to.
+    bool m_deferredStart;
+    bool m_listingStarted;
+
+    // Listed entries waiting to be processed, see ingestEntries. m_resultPending is set when the listing
+    // is done but there still are entries in the queue, completed is emitted once they are processed.
+    bool m_resultPending;
+    QQueue<KIO::UDSEntryList> m_pendingBatches;
+    qint64 m_pendingBytes;
+    bool m_ingestScheduled;
+
+    // The listing is suspended while any SuspendReason is set.
+    int m_suspendReasons;
+    KDirectoryBatchPolicy m_batchPolicy;
+
+    // Details for entries in local folders are loaded in batches, see KStatEngine. Created on the first request.
+    KStatEngine* m_statEngine;
+
+    // Our own KDirWatch, so it only tells us about our own folder. They all share one backend per thread.
     KDirWatch* m_watch;
 
+    // The local path that is being watched, empty if we aren't watching (yet).
+    QString m_watchedPath;
+
+    // Names that KDirWatch reported as changed or created, and as deleted, since the last flushWatchEvents.
+    // m_folderDirty is set when the folder itself changed, that is all that some KDirWatch backends report.
+    QSet<QString> m_dirtyNames;
+    QSet<QString> m_deletedNames;
+    bool m_folderDirty;
+    QTimer m_watchTimer;
+
+    // A relist after KDirWatch told us the directory changed. The result goes in m_relistEntries and is
+    // compared with what we have once done. If another change comes in while relisting we relist again.
+    KIO::ListJob* m_relistJob;
+    QExplicitlySharedDataPointer<KDirectoryEntryStore> m_relistEntries;
+    bool m_relistPending;
+
+    // Stat jobs that are still running, see statPath and startStatJob. Killed when we go away.
+    QSet<KJob*> m_statJobs;
+
+    // Set by reload(), completed is emitted once the relist is applied.
+    bool m_reloading;
+
     QString m_details;
 
+    // The details the current listing runs with. m_details can change while listing, see upgradeDetails.
+    QString m_listingDetails;
+
+    // The second listing that fills in the details after going from details "0" to "2".
+    bool m_upgradePending;
+    KLocalDirLister* m_upgradeLister;
+    KIO::ListJob* m_upgradeJob;
+
+    // List the whole tree instead of just this folder, see KDirectory::setRecursive.
+    bool m_recursive;
+    bool m_listingFailed;
+
+    // See KDirectorySnapshot. m_listingState is the state of the folder when the last (re)listing started.
+    bool m_snapshotsEnabled;
+    KDirectorySnapshot::FolderState m_listingState;
+
     QDir::SortFlags m_sortFlags;
-    QDir::Filters m_filterFlags;
+
+    // Natural order for names. m_sortKeys has the collator key per filtered entry (same index) and is
+    // only filled in when sorting.
+    QCollator m_collator;
+    std::vector<QCollatorSortKey> m_sortKeys;
+    KDirectoryFilter m_filter;
 
 signals:
     void entriesProcessed();
     void completed();
-    void entryDetailsChanged(int id);
+    void entriesDetailsChanged(const KDirectoryRanges& ranges);
+    void entriesAdded(const KDirectoryRanges& ranges);
+    void entriesRemoved(const KDirectoryRanges& ranges);
+    void entriesChanged(const KDirectoryRanges& ranges);
     
 public slots:
+    void autoStart();
+    void startListing();
+    void startStats();
+    void ingestEntries();
+    void flushDetailsChanged();
+    void processEntries(const KIO::UDSEntryList &entries);
+    void listingCompleted();
     void slotEntries(KIO::Job *, const KIO::UDSEntryList &entries);
     void slotResult(KJob *);
+    void slotLocalResult(int error);
+    void slotEntriesStatted(const KIO::UDSEntryList& entries);
+    void slotStatFailed(const QStringList& names);
+    void slotDirty(const QString& path);
+    void slotCreated(const QString& path);
+    void slotDeleted(const QString& path);
+    void flushWatchEvents();
 };
 
 #endif // KDIRECTORYPRIVATE_P_H
@@ -0,0 +1,425 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "kdirectorysnapshot.h"
+#include "kmimetyperegistry.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+
+#include <cstring>
+#include <sys/stat.h>
+
+namespace {
+    const char s_magic[8] = {'K', 'D', 'S', 'N', 'A', 'P', '\0', '\0'};
+    // Version 2: a hidden file in a sub folder has no dot offset anymore.
+    enum { Version = 2 };
+
+    // Every array in the file starts on a multiple of this.
+    enum { Alignment = 8 };
+
+    struct Header {
+        char magic[8];
+        quint32 version;
+        quint32 recursive;
+        qint64 modificationTime;
+        quint64 inode;
+        quint64 device;
+        quint32 filters;
+        quint32 sorting;
+        quint32 detailsLoaded;
+        quint32 byteOrder;
+    };
+
+    // Snapshots are a cache for this machine. They are written in host byte order, a snapshot from a machine with
+    // another byte order is just ignored.
+    const quint32 s_byteOrder = 0x01020304;
+}
+
+class KDirectorySnapshot::Writer
+{
+public:
+    explicit Writer(QIODevice* device)
+        : m_device(device)
+        , m_ok(true)
+    {
+    }
+
+    template<typename T>
+    void write(const T* data, qint64 count)
+    {
+        const qint64 size = count * qint64(sizeof(T));
+        m_ok = m_ok && m_device->write(reinterpret_cast<const char*>(data), size) == size;
+        pad();
+    }
+
+    template<typename T>
+    void write(const T& value)
+    {
+        write(&value, 1);
+    }
+
+    template<typename T>
+    void writeVector(const QVector<T>& vector)
+    {
+        write<qint64>(vector.count());
+        write(vector.constData(), vector.count());
+    }
+
+    void writeString(const QString& string)
+    {
+        write<qint64>(string.size());
+        write(string.utf16(), string.size());
+    }
+
+    bool ok() const { return m_ok; }
+
+private:
+    void pad()
+    {
+        static const char zeros[Alignment] = {};
+        const int rest = m_device->pos() % Alignment;
+        if(rest) {
+            m_ok = m_ok && m_device->write(zeros, Alignment - rest) == Alignment - rest;
+        }
+    }
+
+    QIODevice* m_device;
+    bool m_ok;
+};
+
+class KDirectorySnapshot::Reader
+{
+public:
+    explicit Reader(QIODevice* device)
+        : m_device(device)
+    {
+    }
+
+    // Reads @p count values of T straight into @p data. False if the file is too short (corrupt).
+    template<typename T>
+    bool read(T* data, qint64 count)
+    {
+        if(count < 0 || count > m_device->bytesAvailable() / qint64(sizeof(T))) {
+            return false;
+        }
+        const qint64 size = count * qint64(sizeof(T));
+        return m_device->read(reinterpret_cast<char*>(data), size) == size && skipPadding();
+    }
+
+    template<typename T>
+    bool read(T* value)
+    {
+        return read(value, 1);
+    }
+
+    // The count is checked against what is left in the file before anything is allocated.
+    template<typename T>
+    bool readVector(QVector<T>* vector)
+    {
+        qint64 count = 0;
+        if(!read(&count) || count < 0 || count > m_device->bytesAvailable() / qint64(sizeof(T))) {
+            return false;
+        }
+        vector->resize(count);
+        return read(vector->data(), count);
+    }
+
+    bool readString(QString* string)
+    {
+        qint64 size = 0;
+        if(!read(&size) || size < 0 || size > m_device->bytesAvailable() / qint64(sizeof(ushort))) {
+            return false;
+        }
+        string->resize(size);
+        return read(reinterpret_cast<ushort*>(string->data()), size);
+    }
+
+private:
+    bool skipPadding()
+    {
+        const qint64 rest = m_device->pos() % Alignment;
+        return !rest || m_device->seek(m_device->pos() + Alignment - rest);
+    }
+
+    QIODevice* m_device;
+};
+
+KDirectorySnapshot::KDirectorySnapshot(const QString &url, const QString &details, QDir::Filters filters, QDir::SortFlags sorting, bool recursive)
+    : m_url(url)
+    , m_detailsLoaded(!details.isEmpty() && details != "0")
+    , m_filters(filters)
+    , m_sorting(sorting)
+    , m_recursive(recursive)
+    , m_fileName()
+    , m_state()
+{
+    // Everything that changes what ends up in the stores is part of the key.
+    const QString key = QString("%1\n%2\n%3\n%4\n%5").arg(url).arg(m_detailsLoaded).arg(int(filters)).arg(int(sorting)).arg(recursive);
+    const QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    m_fileName = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/snapshots/") + QString::fromLatin1(hash);
+}
+
+KDirectorySnapshot::FolderState KDirectorySnapshot::folderState(const QString &path)
+{
+    FolderState state;
+    struct stat buff;
+    if(stat(QFile::encodeName(path).constData(), &buff) == -1) {
+        return state;
+    }
+
+#ifdef Q_OS_LINUX
+    state.modificationTime = qint64(buff.st_mtim.tv_sec) * 1000000000 + buff.st_mtim.tv_nsec;
+#else
+    state.modificationTime = qint64(buff.st_mtime) * 1000000000;
+#endif
+    state.inode = buff.st_ino;
+    state.device = buff.st_dev;
+    return state;
+}
+
+bool KDirectorySnapshot::save(const FolderState &state, const KDirectoryEntryStore &filtered, const KDirectoryEntryStore &unused)
+{
+    QDir().mkpath(QFileInfo(m_fileName).path());
+
+    QSaveFile file(m_fileName);
+    if(!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, s_magic, sizeof(header.magic));
+    header.version = Version;
+    header.recursive = m_recursive;
+    header.modificationTime = state.modificationTime;
+    header.inode = state.inode;
+    header.device = state.device;
+    header.filters = m_filters;
+    header.sorting = m_sorting;
+    header.detailsLoaded = m_detailsLoaded;
+    header.byteOrder = s_byteOrder;
+
+    Writer writer(&file);
+    writer.write(header);
+    writer.writeString(m_url);
+    writeStore(writer, filtered);
+    writeStore(writer, unused);
+
+    if(!writer.ok()) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+bool KDirectorySnapshot::load(KDirectoryEntryStore *filtered, KDirectoryEntryStore *unused)
+{
+    // Read straight into the columns of the stores, a mapping would have to be copied into them just the same.
+    QFile file(m_fileName);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        return false;
+    }
+
+    Reader reader(&file);
+    Header header;
+    QString url;
+    bool ok = reader.read(&header)
+           && std::memcmp(header.magic, s_magic, sizeof(header.magic)) == 0
+           && header.version == Version
+           && header.byteOrder == s_byteOrder
+           && header.recursive == quint32(m_recursive)
+           && header.filters == quint32(m_filters)
+           && header.sorting == quint32(m_sorting)
+           && header.detailsLoaded == quint32(m_detailsLoaded)
+           && reader.readString(&url)
+           && url == m_url; // Just to be sure, different urls could have the same hash.
+
+    ok = ok && readStore(reader, filtered) && readStore(reader, unused);
+
+    if(!ok) {
+        filtered->clear();
+        unused->clear();
+        return false;
+    }
+
+    m_state.modificationTime = header.modificationTime;
+    m_state.inode = header.inode;
+    m_state.device = header.device;
+    return true;
+}
+
+bool KDirectorySnapshot::isCurrent() const
+{
+    // The modification time of a folder only changes when it's direct children change, so a recursive snapshot is never trusted.
+    if(m_recursive) {
+        return false;
+    }
+
+    const QUrl url(m_url);
+    return url.isLocalFile() && m_state.inode != 0 && folderState(url.toLocalFile()) == m_state;
+}
+
+void KDirectorySnapshot::writeStore(Writer &writer, const KDirectoryEntryStore &store)
+{
+    writer.writeString(store.m_names);
+    writer.writeVector(store.m_nameOffsets);
+    writer.writeVector(store.m_dotOffsets);
+    writer.writeVector(store.m_modes);
+    writer.writeVector(store.m_sizes);
+    writer.writeVector(store.m_modificationTimes);
+    writer.writeVector(store.m_accessTimes);
+    writer.writeVector(store.m_creationTimes);
+    writer.writeVector(store.m_attributes);
+    writer.writeVector(store.m_fingerprints);
+
+    for(int i = 0; i < KDirectoryEntryStore::DictionaryColumnCount; i++) {
+        const KDirectoryEntryDictionary& dictionary = store.m_dictionaries[i];
+        writer.write<qint64>(dictionary.count());
+        for(int code = 0; code < dictionary.count(); code++) {
+            writer.writeString(dictionary.value(code));
+        }
+        writer.writeVector(store.m_codes[i]);
+    }
+
+    // Mime type ids are only valid in this process. Store the names of the mime types used in this store and
+    // per entry the position in that list.
+    QVector<quint16> mimeTypes;
+    QVector<int> positionForId;
+    QVector<quint16> positions(store.count());
+    for(int i = 0; i < store.count(); i++) {
+        const quint16 id = store.m_mimeTypeIds.at(i);
+        while(positionForId.count() <= id) {
+            positionForId.append(-1);
+        }
+        if(positionForId.at(id) == -1) {
+            positionForId[id] = mimeTypes.count();
+            mimeTypes.append(id);
+        }
+        positions[i] = positionForId.at(id);
+    }
+
+    writer.write<qint64>(mimeTypes.count());
+    for(const quint16 id : mimeTypes) {
+        writer.writeString(KMimeTypeRegistry::self()->mimeType(id).name);
+    }
+    writer.writeVector(positions);
+}
+
+bool KDirectorySnapshot::readStore(Reader &reader, KDirectoryEntryStore *store)
+{
+    store->clear();
+
+    bool ok = reader.readString(&store->m_names)
+           && reader.readVector(&store->m_nameOffsets)
+           && reader.readVector(&store->m_dotOffsets)
+           && reader.readVector(&store->m_modes)
+           && reader.readVector(&store->m_sizes)
+           && reader.readVector(&store->m_modificationTimes)
+           && reader.readVector(&store->m_accessTimes)
+           && reader.readVector(&store->m_creationTimes)
+           && reader.readVector(&store->m_attributes)
+           && reader.readVector(&store->m_fingerprints);
+
+    const int count = store->m_modes.count();
+    ok = ok && store->m_nameOffsets.count() == count && store->m_dotOffsets.count() == count
+            && store->m_sizes.count() == count && store->m_modificationTimes.count() == count
+            && store->m_accessTimes.count() == count && store->m_creationTimes.count() == count
+            && store->m_attributes.count() == count && store->m_fingerprints.count() == count;
+
+    // Inserting the values in code order gives them the same codes they had (code 0, the empty string, is already there).
+    for(int i = 0; ok && i < KDirectoryEntryStore::DictionaryColumnCount; i++) {
+        qint64 numOfValues = 0;
+        ok = reader.read(&numOfValues) && numOfValues >= 1;
+        for(qint64 code = 0; ok && code < numOfValues; code++) {
+            QString value;
+            // A value that is in there twice would give the codes after it another meaning.
+            ok = reader.readString(&value);
+            if(ok && code > 0) {
+                ok = (store->m_dictionaries[i].insert(value) == code);
+            }
+        }
+        ok = ok && reader.readVector(&store->m_codes[i]) && store->m_codes[i].count() == count;
+    }
+
+    qint64 numOfMimeTypes = 0;
+    ok = ok && reader.read(&numOfMimeTypes);
+    QVector<quint16> ids;
+    QMimeDatabase db;
+    for(qint64 i = 0; ok && i < numOfMimeTypes; i++) {
+        QString name;
+        ok = reader.readString(&name);
+        ids.append(KMimeTypeRegistry::self()->idForMimeType(db.mimeTypeForName(name)));
+    }
+
+    QVector<quint16> positions;
+    ok = ok && reader.readVector(&positions) && positions.count() == count;
+    if(ok) {
+        store->m_mimeTypeIds.resize(count);
+        for(int i = 0; i < count && ok; i++) {
+            ok = positions.at(i) < ids.count();
+            store->m_mimeTypeIds[i] = ok ? ids.at(positions.at(i)) : quint16(KMimeTypeRegistry::InvalidId);
+        }
+    }
+
+    ok = ok && isValid(*store);
+    if(!ok) {
+        store->clear();
+    }
+    return ok;
+}
+
+bool KDirectorySnapshot::isValid(const KDirectoryEntryStore &store)
+{
+    // The sizes match (see readStore), but a damaged file can still have offsets and codes that point anywhere.
+    // Everything that is used as an index is checked once here, so the store never has to.
+    const int count = store.m_modes.count();
+    const int namesSize = store.m_names.size();
+    int previous = 0;
+    for(int i = 0; i < count; i++) {
+        const int offset = store.m_nameOffsets.at(i);
+        if(offset < previous || offset > namesSize) {
+            return false;
+        }
+        previous = offset;
+    }
+
+    for(int i = 0; i < count; i++) {
+        const int end = (i + 1 < count) ? store.m_nameOffsets.at(i + 1) : namesSize;
+        const int dot = store.m_dotOffsets.at(i);
+        if(dot < -1 || dot >= end - store.m_nameOffsets.at(i)) {
+            return false;
+        }
+    }
+
+    for(int column = 0; column < KDirectoryEntryStore::DictionaryColumnCount; column++) {
+        const int numOfCodes = store.m_dictionaries[column].count();
+        for(const int code : store.m_codes[column]) {
+            if(code < 0 || code >= numOfCodes) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,112 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KDIRECTORYSNAPSHOT_H
+#define KDIRECTORYSNAPSHOT_H
+
+#include <QString>
+#include <QDir>
+
+#include "kdirectoryentrystore.h"
+
+/**
+ * A listed directory stored on disk, so the next time it is opened (even in another session) it
+ * can be shown right away instead of waiting for the listing.
+ *
+ * A snapshot holds the filtered and unused entries of one directory. The columns are written
+ * as they are in memory (aligned on 8 bytes), so loading is reading a couple of big arrays straight
+ * into the store. Offsets and codes are checked after loading, a damaged file is ignored like a
+ * missing one. The file is keyed by the url and everything that changes the
+ * content of the stores (details, filters, sorting, recursive). Besides that the snapshot knows
+ * the modification time and inode the folder had when it was listed, see isCurrent().
+ *
+ * The sort keys aren't stored (QCollatorSortKey can't be saved), the entries are stored in their
+ * sorted order instead. The mime types are stored by name since the ids are only valid in one process.
+ */
+class KDirectorySnapshot
+{
+public:
+    /**
+     * The folder as it is on disk. If this didn't change since the snapshot was made, the snapshot is current.
+     */
+    struct FolderState {
+        FolderState() : modificationTime(0), inode(0), device(0) {}
+
+        bool operator==(const FolderState& other) const
+        {
+            return modificationTime == other.modificationTime && inode == other.inode && device == other.device;
+        }
+
+        // Nanoseconds since epoch, where the file system has them.
+        qint64 modificationTime;
+        quint64 inode;
+        quint64 device;
+    };
+
+    KDirectorySnapshot(const QString& url, const QString& details, QDir::Filters filters, QDir::SortFlags sorting, bool recursive);
+
+    /**
+     * Returns the state of the local folder @p path right now.
+     * @return FolderState, all zero if the folder can't be stat'ed.
+     */
+    static FolderState folderState(const QString& path);
+
+    /**
+     * The file this snapshot is stored in.
+     * @return QString
+     */
+    QString fileName() const { return m_fileName; }
+
+    /**
+     * Writes the stores to disk. The file is replaced at once, a reader never sees half a snapshot.
+     * @param state the state of the folder when the listing started.
+     * @return bool false if the snapshot couldn't be written.
+     */
+    bool save(const FolderState& state, const KDirectoryEntryStore& filtered, const KDirectoryEntryStore& unused);
+
+    /**
+     * Reads the snapshot into two empty stores.
+     * @return bool false if there is no (valid) snapshot, the stores are left empty in that case.
+     */
+    bool load(KDirectoryEntryStore* filtered, KDirectoryEntryStore* unused);
+
+    /**
+     * Returns true if the folder didn't change since the loaded snapshot was made. Only valid after load().
+     * @return bool
+     */
+    bool isCurrent() const;
+
+private:
+    class Reader;
+    class Writer;
+
+    static void writeStore(Writer& writer, const KDirectoryEntryStore& store);
+    static bool readStore(Reader& reader, KDirectoryEntryStore* store);
+    static bool isValid(const KDirectoryEntryStore& store);
+
+    QString m_url;
+    bool m_detailsLoaded;
+    QDir::Filters m_filters;
+    QDir::SortFlags m_sorting;
+    bool m_recursive;
+    QString m_fileName;
+    FolderState m_state;
+};
+
+#endif // KDIRECTORYSNAPSHOT_H
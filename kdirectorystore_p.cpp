@@ -0,0 +1,148 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "kdirectorystore_p.h"
+
+// Qt includes
+#include <QCoreApplication>
+#include <QPointer>
+#include <QDebug>
+
+KDirectoryStore::KDirectoryStore(QObject *parent)
+    : QObject(parent)
+    , m_cache()
+    , m_scheduler()
+{
+}
+
+KDirectoryStore *KDirectoryStore::self()
+{
+    // A child of the application. The directories are our children, so they (and the jobs they might still
+    // have running) are gone before the application is.
+    static QPointer<KDirectoryStore> s_store;
+    if(!s_store) {
+        s_store = new KDirectoryStore(QCoreApplication::instance());
+    }
+    return s_store;
+}
+
+KDirectory *KDirectoryStore::directory(const KDirListerV2::DirectoryFetchDetails &dirFetchDetails, bool *attached)
+{
+    // One listing per url, filter, sorting and depth. If we already have the directory (listed or still listing)
+    // the caller gets that one.
+    const QString key = cacheKey(dirFetchDetails);
+    KDirectory* dir = m_cache.object(key);
+    if(dir) {
+        // Details are only ever added, someone else might still need them.
+        if(dirFetchDetails.details == "2") {
+            dir->setDetails(dirFetchDetails.details);
+        }
+
+        // A Reload keeps serving what we have while the folder is listed again in the background. Only the
+        // differences are reported once that is done. A listing that is still running is as fresh as it gets.
+        if(dirFetchDetails.openFlags.testFlag(KDirListerV2::Reload)) {
+            dir->reload();
+        }
+
+        // Someone looking at a folder that was being prefetched shouldn't have to wait for it.
+        m_scheduler.raisePriority(dir, dirFetchDetails.priority);
+
+        *attached = true;
+        return dir;
+    }
+
+    qDebug() << "Added new url:" << dirFetchDetails.url << "DETAILS:" << dirFetchDetails.details;
+    *attached = false;
+    return newDirectory(dirFetchDetails);
+}
+
+KDirectory *KDirectoryStore::directory(const QString &url)
+{
+    return m_cache.objectWithPrefix(cacheKeyPrefix(url));
+}
+
+KDirectory *KDirectoryStore::newDirectory(const KDirListerV2::DirectoryFetchDetails &dirFetchDetails)
+{
+    KDirectory* dir = new KDirectory(dirFetchDetails.url, this);
+    dir->setRecursive(dirFetchDetails.openFlags.testFlag(KDirListerV2::Recursive));
+    dir->setSnapshotsEnabled(dirFetchDetails.snapshot);
+    dir->setSorting(dirFetchDetails.sorting);
+    dir->setFilter(dirFetchDetails.filters);
+    dir->setDetails(dirFetchDetails.details);
+    dir->setBatchPolicy(KDirectoryBatchPolicy(dirFetchDetails.firstBatchSize, dirFetchDetails.frameBudget));
+    dir->setDeferredStart(true);
+
+    // Add it to the cache. Least recently used directories that nobody uses anymore are evicted once the cache
+    // is over budget.
+    m_cache.insert(cacheKey(dirFetchDetails), dir);
+
+    connect(dir, &KDirectory::cancelled, this, &KDirectoryStore::slotCancelled);
+    connect(dir, &KDirectory::released, this, &KDirectoryStore::slotReleased);
+
+    // The memory a directory uses grows while it's being listed.
+    connect(dir, &KDirectory::entriesProcessed, this, &KDirectoryStore::slotCostChanged);
+    connect(dir, &KDirectory::completed, this, &KDirectoryStore::slotCostChanged);
+    connect(dir, &KDirectory::entriesAdded, this, &KDirectoryStore::slotCostChanged);
+
+    m_scheduler.schedule(dir, dirFetchDetails.priority);
+    return dir;
+}
+
+QString KDirectoryStore::cacheKey(const KDirListerV2::DirectoryFetchDetails &dirFetchDetails)
+{
+    return cacheKeyPrefix(dirFetchDetails.url)
+        + QString::number(static_cast<int>(dirFetchDetails.filters)) + QLatin1Char(':')
+        + QString::number(static_cast<int>(dirFetchDetails.sorting)) + QLatin1Char(':')
+        + (dirFetchDetails.openFlags.testFlag(KDirListerV2::Recursive) ? QLatin1Char('r') : QLatin1Char('-'));
+}
+
+QString KDirectoryStore::cacheKeyPrefix(const QString &url)
+{
+    // A url has no new lines, so one url is never the prefix of the key of another.
+    return url + QLatin1Char('\n');
+}
+
+void KDirectoryStore::slotCancelled(KDirectory *dir)
+{
+    // Whatever was listed till now is incomplete, the next openUrl for this url starts over.
+    // The cache key starts with the url as it was given to us, which isn't always equal to KDirectory::url().
+    const QString key = m_cache.key(dir);
+    if(!key.isNull()) {
+        m_cache.remove(key);
+    } else {
+        dir->deleteLater();
+    }
+}
+
+void KDirectoryStore::slotReleased(KDirectory *dir)
+{
+    // A directory that was removed from the cache (cancelled) while someone still used it is of no use anymore.
+    if(m_cache.key(dir).isNull()) {
+        dir->deleteLater();
+        return;
+    }
+
+    // It can be evicted now, which might be needed if the cache went over budget while it was in use.
+    m_cache.trim();
+}
+
+void KDirectoryStore::slotCostChanged(KDirectory *dir)
+{
+    m_cache.updateCost(dir);
+}
@@ -0,0 +1,87 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KDIRECTORYSTORE_P_H
+#define KDIRECTORYSTORE_P_H
+
+#include <QObject>
+
+#include "kdirlisterv2.h"
+#include "kdirectory.h"
+#include "kdirectorycache_p.h"
+#include "klistingscheduler.h"
+
+/**
+ * The directories of all KDirListerV2 objects in this process.
+ *
+ * There is one KDirectory per listed url, filter, sorting and depth (see cacheKey), no matter how
+ * many listers or models show it. Two views of the same folder with a different sorting each have
+ * their own directory, they don't push each other out of the cache. Listers and models reference the directories they use
+ * (KDirectory::ref). A directory nobody references anymore stays in the cache till it is
+ * evicted, see KDirectoryCache. One that is dropped while it's still being listed is cancelled
+ * and deleted right away.
+ *
+ * Only use this from the GUI thread.
+ */
+class KDirectoryStore : public QObject
+{
+    Q_OBJECT
+public:
+    static KDirectoryStore* self();
+
+    /**
+     * Returns the directory for @p dirFetchDetails. That is the one we already have if it's listed (or still
+     * being listed) the same way, otherwise a new one that is scheduled to be listed. A Reload doesn't give a
+     * new directory, the one we have lists again in the background (KDirectory::reload). Either way the caller
+     * has to ref() it.
+     * @param attached set to true if the directory already existed.
+     * @return KDirectory pointer
+     */
+    KDirectory* directory(const KDirListerV2::DirectoryFetchDetails& dirFetchDetails, bool* attached);
+
+    /**
+     * Looks up the most recently used directory for @p url, however it's listed. Counts as a cache hit or miss.
+     * @return KDirectory pointer or 0 if the url isn't cached.
+     */
+    KDirectory* directory(const QString& url);
+
+    KDirectoryCache& cache() { return m_cache; }
+    KListingScheduler& scheduler() { return m_scheduler; }
+
+private slots:
+    void slotCancelled(KDirectory* dir);
+    void slotReleased(KDirectory* dir);
+    void slotCostChanged(KDirectory* dir);
+
+private:
+    explicit KDirectoryStore(QObject* parent = 0);
+    KDirectory* newDirectory(const KDirListerV2::DirectoryFetchDetails& dirFetchDetails);
+
+    // The url followed by the filter, sorting and depth. A different one of those is a different listing,
+    // changing them on a directory someone else shows would change their view.
+    static QString cacheKey(const KDirListerV2::DirectoryFetchDetails& dirFetchDetails);
+    static QString cacheKeyPrefix(const QString& url);
+
+    KDirectoryCache m_cache;
+
+    // New directories don't start listing themselves, they wait for their turn here.
+    KListingScheduler m_scheduler;
+};
+
+#endif // KDIRECTORYSTORE_P_H
@@ -29,6 +29,11 @@ KDirListerV2::KDirListerV2(QObject *parent)
     connect(d, SIGNAL(directoryContentChanged(KDirectory*)), this, SIGNAL(directoryContentChanged(KDirectory*)));
 }
 
+KDirListerV2::~KDirListerV2()
+{
+    delete d;
+}
+
 bool KDirListerV2::openUrl(const QString &url, OpenUrlFlags flags)
 {
     // Whatever the URL or Flags might be, pass it along to the private class. It will determine what to do.
@@ -53,3 +58,38 @@ KDirectory *KDirListerV2::directory(const QString &url)
 {
     return d->directory(url);
 }
+
+KListingScheduler *KDirListerV2::scheduler()
+{
+    return &d->m_store->scheduler();
+}
+
+qint64 KDirListerV2::cacheBudget()
+{
+    return d->m_store->cache().budget();
+}
+
+void KDirListerV2::setCacheBudget(qint64 bytes)
+{
+    d->m_store->cache().setBudget(bytes);
+}
+
+qint64 KDirListerV2::cacheMemoryUsage()
+{
+    return d->m_store->cache().memoryUsage();
+}
+
+quint64 KDirListerV2::cacheHits()
+{
+    return d->m_store->cache().hits();
+}
+
+quint64 KDirListerV2::cacheMisses()
+{
+    return d->m_store->cache().misses();
+}
+
+quint64 KDirListerV2::cacheEvictions()
+{
+    return d->m_store->cache().evictions();
+}
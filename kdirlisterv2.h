@@ -23,6 +23,7 @@
 #include <QObject>
 #include <QDir>
 #include "kdirectory.h"
+#include "klistingscheduler.h"
 
 class KDirListerV2Private;
 
@@ -39,10 +40,12 @@ public:
                        ///< are kept for this KDirLister). This is useful for e.g.
                        ///< a treeview.
 
-      Reload = 0x2     ///< Indicates whether to use the cache or to reread
-                       ///< the directory from the disk.
-                       ///< Use only when opening a dir not yet listed by this lister
-                       ///< without using the cache. Otherwise use updateDirectory.
+      Reload = 0x2,    ///< Reread the directory from the disk. The cached
+                       ///< entries are kept while that happens and only
+                       ///< the differences are reported once it's done.
+
+      Recursive = 0x4  ///< List all sub folders as well. Entries stream in as
+                       ///< they are found, see KDirectory::setRecursive.
     };
 
     Q_DECLARE_FLAGS(OpenUrlFlags, OpenUrlFlag)
@@ -53,14 +56,37 @@ public:
         QDir::Filters filters = QDir::NoFilter;
         QDir::SortFlags sorting = QDir::NoSort;
         KDirListerV2::OpenUrlFlags openFlags = OpenUrlFlag::NoFlags;
+
+        // Number of entries in the first entriesProcessed and the time (in milliseconds) processing a batch
+        // may take, see KDirectoryBatchPolicy.
+        int firstBatchSize = KDirectoryBatchPolicy::DefaultFirstBatchSize;
+        int frameBudget = KDirectoryBatchPolicy::DefaultFrameBudget;
+
+        // Show the snapshot of the last listing (if any) right away, see KDirectory::setSnapshotsEnabled.
+        bool snapshot = false;
+
+        // How important this listing is compared to others, see KListingScheduler.
+        KListingScheduler::Priority priority = KListingScheduler::Foreground;
     };
 
 
     explicit KDirListerV2(QObject *parent = 0);
+    ~KDirListerV2();
 
     /**
      * Open a new URL to be listed.
      *
+     * If the URL is already listed or being listed (with the same filter, sorting and depth) no new
+     * listing is started. The caller gets the same KDirectory: directoryContentChanged reports the
+     * entries it has so far and the rest comes in as it is listed. Other listers in this process share
+     * the same directories.
+     *
+     * With Reload the directory keeps it's entries while it's listed again in the background, then
+     * only the differences are reported (see KDirectory::reload) and completed is emitted again.
+     *
+     * Without Keep the directories this lister opened before are released. One that is still being
+     * listed and isn't used by anyone else is cancelled.
+     *
      * @param url the directory URL.
      * @param flags. Can be NoFlags, Keep or Reload
      * @return true if successful, false otherwise.
@@ -90,6 +116,33 @@ public:
      * @return KDirectory pointer if url is known, nullptr otherwise.
      */
     virtual KDirectory* directory(const QString& url);
+
+    /**
+     * Listed directories are kept in a least recently used cache that all listers in this process share.
+     * Once it uses more then the budget, directories that aren't used by any lister or model are dropped,
+     * oldest first. Setting the budget sets it for everyone.
+     * @return qint64 the budget in bytes.
+     */
+    qint64 cacheBudget();
+    void setCacheBudget(qint64 bytes);
+
+    /**
+     * Bytes used by all cached directories, see KDirectory::memoryUsage.
+     * @return qint64
+     */
+    qint64 cacheMemoryUsage();
+
+    /**
+     * Decides which listings run, shared by all listers in this process. Use it to set the number of
+     * listings per url scheme or to plug in another backend.
+     * @return KListingScheduler
+     */
+    KListingScheduler* scheduler();
+
+    // Cache statistics. A hit or miss is counted for every openUrl and directory() lookup.
+    quint64 cacheHits();
+    quint64 cacheMisses();
+    quint64 cacheEvictions();
     
 signals:
     /**
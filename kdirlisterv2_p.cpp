@@ -21,14 +21,26 @@
 
 // Qt includes
 #include <QDebug>
+#include <QTimer>
 
 
 KDirListerV2Private::KDirListerV2Private(KDirListerV2* dirLister)
     : q(dirLister)
-    , m_cache()
+    , m_store(KDirectoryStore::self())
+    , m_directories()
+    , m_pendingReplays()
 {
 }
 
+KDirListerV2Private::~KDirListerV2Private()
+{
+    // Directories that are still being listed and aren't used by anyone else are cancelled.
+    const QStringList urls = m_directories.keys();
+    for(const QString& url : urls) {
+        forgetUrl(url);
+    }
+}
+
 void KDirListerV2Private::addUrl(QString url, KDirListerV2::OpenUrlFlags flags)
 {
     KDirListerV2::DirectoryFetchDetails dirFetchDetails;
@@ -40,39 +52,92 @@ void KDirListerV2Private::addUrl(QString url, KDirListerV2::OpenUrlFlags flags)
 
 void KDirListerV2Private::addUrl(KDirListerV2::DirectoryFetchDetails dirFetchDetails)
 {
-    // We take a different path if we want to reload a url that is currently being monitored.
-    // Otherwise we add a new url
-    if(m_cache.contains(dirFetchDetails.url) && dirFetchDetails.openFlags.testFlag(KDirListerV2::Reload)) {
-        // Remove URL from m_lruCache.
-        m_cache.remove(dirFetchDetails.url);
+    bool attached = false;
+    KDirectory* dir = m_store->directory(dirFetchDetails, &attached);
+
+    // A different filter, sorting or depth gave us another directory for a url we where already using.
+    if(m_directories.value(dirFetchDetails.url) != dir) {
+        forgetUrl(dirFetchDetails.url);
+        holdUrl(dirFetchDetails.url, dir);
     }
 
-    qDebug() << "Added new url:" << dirFetchDetails.url << "DETAILS:" << dirFetchDetails.details;
-    newUrl(dirFetchDetails);
+    // Without Keep we only use the directory we just opened. The others are released, a listing nobody else uses is cancelled.
+    if(!dirFetchDetails.openFlags.testFlag(KDirListerV2::Keep)) {
+        const QStringList urls = m_directories.keys();
+        for(const QString& url : urls) {
+            if(url != dirFetchDetails.url) {
+                forgetUrl(url);
+            }
+        }
+    }
+
+    if(attached) {
+        attachUrl(dirFetchDetails.url, dir);
+    }
 }
 
-void KDirListerV2Private::newUrl(KDirListerV2::DirectoryFetchDetails dirFetchDetails)
+void KDirListerV2Private::holdUrl(const QString &url, KDirectory *dir)
 {
-    KDirectory* dir = new KDirectory(dirFetchDetails.url);
-    dir->setSorting(dirFetchDetails.sorting);
-    dir->setFilter(dirFetchDetails.filters);
-    dir->setDetails(dirFetchDetails.details);
-
-    // Add node to list. This list will stay and will only get shorter (dir removed) if the physical directory is removed
-    // Or if some cache mechanism kicks in that decided this dir is useless weight.
-    m_cache.insert(dirFetchDetails.url, dir);
+    dir->ref();
+    m_directories.insert(url, dir);
 
     // And we make some connections
     connect(dir, SIGNAL(entriesProcessed(KDirectory*)), this, SIGNAL(directoryContentChanged(KDirectory*)));
     connect(dir, SIGNAL(completed(KDirectory*)), this, SIGNAL(completed(KDirectory*)));
 }
 
+void KDirListerV2Private::forgetUrl(const QString &url)
+{
+    KDirectory* dir = m_directories.take(url);
+    if(!dir) {
+        return;
+    }
+
+    disconnect(dir, 0, this, 0);
+    dir->deref();
+}
+
+void KDirListerV2Private::attachUrl(const QString &url, KDirectory *dir)
+{
+    PendingReplay pendingReplay;
+    pendingReplay.url = url;
+    pendingReplay.dir = dir;
+    m_pendingReplays.append(pendingReplay);
+    if(m_pendingReplays.count() == 1) {
+        QTimer::singleShot(0, this, SLOT(replay()));
+    }
+}
+
+void KDirListerV2Private::replay()
+{
+    const QList<PendingReplay> pendingReplays = m_pendingReplays;
+    m_pendingReplays.clear();
+
+    for(const PendingReplay& pendingReplay : pendingReplays) {
+        // We don't use this directory anymore, another url was opened in the meantime.
+        KDirectory* dir = pendingReplay.dir.data();
+        if(!dir || m_directories.value(pendingReplay.url) != dir) {
+            continue;
+        }
+
+        // Everything that is ingested so far in one go. What's still to come streams in through the
+        // connections made in holdUrl, just like for whoever opened the url first.
+        if(dir->count() > 0) {
+            emit directoryContentChanged(dir);
+        }
+        if(dir->isCompleted()) {
+            emit completed(dir);
+        }
+    }
+}
+
 bool KDirListerV2Private::isListing(const QString &url)
 {
-    return m_cache.contains(url);
+    return m_directories.contains(url);
 }
 
 KDirectory *KDirListerV2Private::directory(const QString &url)
 {
-    return m_cache[url];
+    KDirectory* dir = m_directories.value(url);
+    return dir ? dir : m_store->directory(url);
 }
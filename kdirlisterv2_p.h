@@ -23,25 +23,34 @@
 // Qt includes
 #include <QObject>
 #include <QStringList>
+#include <QList>
 #include <QHash>
+#include <QPointer>
 
 // KDE includes
 #include <KIO/Job>
 
 #include "kdirlisterv2.h"
 #include "kdirectory.h"
+#include "kdirectorystore_p.h"
 
 class KDirListerV2Private : public QObject
 {
     Q_OBJECT
 public:
     explicit KDirListerV2Private(KDirListerV2* dirLister);
+    ~KDirListerV2Private();
 
     void addUrl(QString url, KDirListerV2::OpenUrlFlags flags);
     void addUrl(KDirListerV2::DirectoryFetchDetails dirFetchDetails);
-    void newUrl(KDirListerV2::DirectoryFetchDetails dirFetchDetails);
+    void holdUrl(const QString& url, KDirectory* dir);
+    void forgetUrl(const QString& url);
+    void attachUrl(const QString& url, KDirectory* dir);
     bool isListing(const QString& url);
     KDirectory* directory(const QString& url);
+
+public slots:
+    void replay();
     
 signals:
     void directoryContentChanged(KDirectory* directoryContent);
@@ -50,7 +59,19 @@ signals:
 // Just for those values that don't need a function.. Remember, we are in a private class here anyway!
 public:
     KDirListerV2* q;
-    QHash<QString, KDirectory*> m_cache;
+
+    // The directories are shared by all listers, see KDirectoryStore. m_directories are the ones this lister
+    // uses (and references), by the url they where opened with. Only their signals are forwarded.
+    KDirectoryStore* m_store;
+    QHash<QString, KDirectory*> m_directories;
+
+    // openUrl calls that got attached to a directory we already have (see attachUrl). What that directory
+    // has so far is handed out from the event loop, the same way a new listing reports it's first entries.
+    struct PendingReplay {
+        QString url;
+        QPointer<KDirectory> dir;
+    };
+    QList<PendingReplay> m_pendingReplays;
 };
 
 #endif // KDIRLISTERV2_P_H
@@ -0,0 +1,198 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "klistingscheduler.h"
+#include "kdirectory.h"
+
+#include <QUrl>
+
+namespace {
+    class DirectoryBackend : public KListingScheduler::Backend
+    {
+    public:
+        void start(KDirectory* dir) { dir->start(); }
+        void suspend(KDirectory* dir) { dir->suspend(); }
+        void resume(KDirectory* dir) { dir->resume(); }
+    };
+}
+
+KListingScheduler::KListingScheduler(QObject *parent)
+    : QObject(parent)
+    , m_backend(new DirectoryBackend())
+    , m_jobs()
+    , m_maxConcurrency()
+    , m_running()
+    , m_sequence(0)
+{
+    m_maxConcurrency.insert(QStringLiteral("file"), DefaultLocalMaxConcurrency);
+}
+
+KListingScheduler::~KListingScheduler()
+{
+    delete m_backend;
+}
+
+void KListingScheduler::setBackend(KListingScheduler::Backend *backend)
+{
+    delete m_backend;
+    m_backend = backend ? backend : new DirectoryBackend();
+}
+
+int KListingScheduler::maxConcurrency(const QString &scheme) const
+{
+    return m_maxConcurrency.value(scheme, DefaultMaxConcurrency);
+}
+
+void KListingScheduler::setMaxConcurrency(const QString &scheme, int max)
+{
+    m_maxConcurrency.insert(scheme, qMax(1, max));
+    dispatch(scheme);
+}
+
+void KListingScheduler::schedule(KDirectory *dir, KListingScheduler::Priority priority)
+{
+    if(m_jobs.contains(dir)) {
+        raisePriority(dir, priority);
+        return;
+    }
+
+    Job job;
+    job.scheme = QUrl(dir->url()).scheme();
+    job.priority = priority;
+    job.sequence = m_sequence++;
+    job.started = false;
+    job.suspended = false;
+    m_jobs.insert(dir, job);
+
+    // The default backend finishes on the signals of the directory. Others call finished() themselves, doing both is fine.
+    connect(dir, &KDirectory::completed, this, &KListingScheduler::slotFinished, Qt::UniqueConnection);
+    connect(dir, &KDirectory::cancelled, this, &KListingScheduler::slotFinished, Qt::UniqueConnection);
+    connect(dir, &QObject::destroyed, this, &KListingScheduler::slotDestroyed, Qt::UniqueConnection);
+
+    dispatch(job.scheme);
+}
+
+void KListingScheduler::raisePriority(KDirectory *dir, KListingScheduler::Priority priority)
+{
+    QHash<KDirectory*, Job>::iterator it = m_jobs.find(dir);
+    if(it == m_jobs.end() || it.value().priority <= priority) {
+        return;
+    }
+
+    it.value().priority = priority;
+    dispatch(it.value().scheme);
+}
+
+void KListingScheduler::finished(KDirectory *dir)
+{
+    QHash<KDirectory*, Job>::iterator it = m_jobs.find(dir);
+    if(it == m_jobs.end()) {
+        return;
+    }
+
+    const Job job = it.value();
+    m_jobs.erase(it);
+    if(job.started && !job.suspended) {
+        m_running[job.scheme]--;
+    }
+
+    dispatch(job.scheme);
+}
+
+int KListingScheduler::waitingCount(const QString &scheme) const
+{
+    int count = 0;
+    for(const Job& job : m_jobs) {
+        if(job.scheme == scheme && (!job.started || job.suspended)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void KListingScheduler::slotFinished(KDirectory *dir)
+{
+    disconnect(dir, 0, this, 0);
+    finished(dir);
+}
+
+void KListingScheduler::slotDestroyed(QObject *object)
+{
+    // Only the address is used, the KDirectory part is already gone.
+    finished(static_cast<KDirectory*>(object));
+}
+
+bool KListingScheduler::isBefore(const KListingScheduler::Job &a, const KListingScheduler::Job &b)
+{
+    if(a.priority != b.priority) {
+        return a.priority < b.priority;
+    }
+    return a.sequence < b.sequence;
+}
+
+void KListingScheduler::dispatch(const QString &scheme)
+{
+    // There are only ever a handful of jobs, a linear scan per decision is all it takes.
+    const int max = maxConcurrency(scheme);
+    forever {
+        // The most important job that isn't running.
+        QHash<KDirectory*, Job>::iterator next = m_jobs.end();
+        for(QHash<KDirectory*, Job>::iterator it = m_jobs.begin(); it != m_jobs.end(); ++it) {
+            const Job& job = it.value();
+            if(job.scheme == scheme && (!job.started || job.suspended) && (next == m_jobs.end() || isBefore(job, next.value()))) {
+                next = it;
+            }
+        }
+        if(next == m_jobs.end()) {
+            return;
+        }
+
+        // No room. Make some if the least important running job is less important then this one.
+        if(m_running.value(scheme) >= max) {
+            QHash<KDirectory*, Job>::iterator victim = m_jobs.end();
+            for(QHash<KDirectory*, Job>::iterator it = m_jobs.begin(); it != m_jobs.end(); ++it) {
+                const Job& job = it.value();
+                if(job.scheme == scheme && job.started && !job.suspended && (victim == m_jobs.end() || isBefore(victim.value(), job))) {
+                    victim = it;
+                }
+            }
+            if(victim == m_jobs.end() || victim.value().priority <= next.value().priority) {
+                return;
+            }
+
+            // Look again after the backend had it's say, it might finish jobs right away.
+            victim.value().suspended = true;
+            m_running[scheme]--;
+            m_backend->suspend(victim.key());
+            continue;
+        }
+
+        KDirectory* dir = next.key();
+        Job& job = next.value();
+        const bool resume = job.started;
+        job.started = true;
+        job.suspended = false;
+        m_running[scheme]++;
+        if(resume) {
+            m_backend->resume(dir);
+        } else {
+            m_backend->start(dir);
+        }
+    }
+}
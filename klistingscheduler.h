@@ -0,0 +1,131 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KLISTINGSCHEDULER_H
+#define KLISTINGSCHEDULER_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+
+class KDirectory;
+
+/**
+ * Decides which directory listings run.
+ *
+ * Every listing has a priority. Per url scheme only a limited number of listings run at the
+ * same time (setMaxConcurrency), the rest waits. The most important waiting listing goes first,
+ * listings with the same priority go in the order they where scheduled. When a listing comes
+ * in that is more important then one that is running and there is no room for it, the less
+ * important one is suspended. It continues once there is room again.
+ *
+ * A suspended local listing parks it's own worker threads (see KLocalDirLister), so the listing that
+ * takes it's place never waits for a thread the suspended one holds. A suspended KIO listing keeps
+ * it's slave, that's why remote schemes have a lower limit.
+ *
+ * What starting, suspending and resuming means is up to the Backend. The default one starts the
+ * KDirectory listing and finishes it on KDirectory::completed or cancelled. Another backend
+ * (a fake slow one for testing for example) has to call finished() itself.
+ */
+class KListingScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority {
+        Foreground = 0, // The folder the user looks at.
+        Prefetch,       // Folders the user is likely to open next.
+        Background      // Everything else, nobody waits for these. A recursive listing is one listing, its sub folders are not scheduled.
+    };
+
+    // Local folders are read from disk with a few threads each, remote ones cost a kioslave each.
+    enum { DefaultLocalMaxConcurrency = 4, DefaultMaxConcurrency = 2 };
+
+    class Backend
+    {
+    public:
+        virtual ~Backend() {}
+        virtual void start(KDirectory* dir) = 0;
+        virtual void suspend(KDirectory* dir) = 0;
+        virtual void resume(KDirectory* dir) = 0;
+    };
+
+    explicit KListingScheduler(QObject* parent = 0);
+    ~KListingScheduler();
+
+    /**
+     * Replaces the backend. The scheduler takes ownership, 0 goes back to the default backend.
+     * Only do this while nothing is scheduled.
+     */
+    void setBackend(Backend* backend);
+    Backend* backend() { return m_backend; }
+
+    /**
+     * The number of listings that run at the same time for urls with @p scheme ("file", "sftp", ...).
+     */
+    int maxConcurrency(const QString& scheme) const;
+    void setMaxConcurrency(const QString& scheme, int max);
+
+    /**
+     * Adds the listing of @p dir. It starts right away if there is room for it.
+     */
+    void schedule(KDirectory* dir, Priority priority);
+
+    /**
+     * Makes the listing of @p dir more important, for example when a prefetched folder gets opened.
+     * A lower priority then the current one is ignored.
+     */
+    void raisePriority(KDirectory* dir, Priority priority);
+
+    /**
+     * The listing of @p dir is done (or cancelled). Makes room for the next one.
+     */
+    void finished(KDirectory* dir);
+
+    int runningCount(const QString& scheme) const { return m_running.value(scheme); }
+    int waitingCount(const QString& scheme) const;
+
+private slots:
+    void slotFinished(KDirectory* dir);
+    void slotDestroyed(QObject* object);
+
+private:
+    struct Job {
+        QString scheme;
+        Priority priority;
+
+        // Order of scheduling, the oldest job goes first between jobs with the same priority.
+        quint64 sequence;
+        bool started;
+        bool suspended;
+    };
+
+    // Returns true if job a should run before job b.
+    static bool isBefore(const Job& a, const Job& b);
+    void dispatch(const QString& scheme);
+
+    Backend* m_backend;
+    QHash<KDirectory*, Job> m_jobs;
+    QHash<QString, int> m_maxConcurrency;
+
+    // Jobs per scheme that are started and not suspended.
+    QHash<QString, int> m_running;
+    quint64 m_sequence;
+};
+
+#endif // KLISTINGSCHEDULER_H
@@ -0,0 +1,326 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "klocaldirlister_p.h"
+#include "klocalstat_p.h"
+
+// Qt includes
+#include <QFile>
+#include <QMetaType>
+#include <QtConcurrent/QtConcurrentRun>
+
+// System includes
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#endif
+
+namespace {
+#ifdef Q_OS_LINUX
+    // glibc only got a getdents64 wrapper in 2.30, so we use the syscall and declare the record ourselves.
+    struct linux_dirent64 {
+        quint64 d_ino;
+        qint64 d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+#endif
+
+    // d_type to the file type bits of st_mode. 0 means we don't know and need a stat.
+    mode_t fileTypeFromDirentType(unsigned char type)
+    {
+        switch (type) {
+        case DT_DIR:
+            return S_IFDIR;
+        case DT_REG:
+            return S_IFREG;
+        case DT_CHR:
+            return S_IFCHR;
+        case DT_BLK:
+            return S_IFBLK;
+        case DT_FIFO:
+            return S_IFIFO;
+        case DT_SOCK:
+            return S_IFSOCK;
+        default:
+            // DT_LNK needs a stat as well, the type of a link is the type of what it points to (just like the file slave does).
+            return 0;
+        }
+    }
+}
+
+KLocalDirLister::KLocalDirLister(const QString &path, const QString &details, bool recursive, QObject *parent)
+    : QObject(parent)
+    , m_path(path)
+    , m_details(!details.isEmpty() && details != "0")
+    , m_recursive(recursive)
+    , m_threadPool()
+    , m_future()
+    , m_cancelled(false)
+    , m_suspendMutex()
+    , m_resumed()
+    , m_suspended(false)
+    , m_foldersMutex()
+    , m_foldersChanged()
+    , m_folders()
+    , m_activeFolders(0)
+{
+    // The entries signal crosses from the worker thread to the thread we live in.
+    qRegisterMetaType<KIO::UDSEntryList>("KIO::UDSEntryList");
+
+    // Room for the thread running list() and the workers of a recursive listing.
+    m_threadPool.setMaxThreadCount(m_recursive ? MaxParallelFolders : 1);
+}
+
+KLocalDirLister::~KLocalDirLister()
+{
+    kill();
+    m_threadPool.waitForDone();
+}
+
+void KLocalDirLister::start()
+{
+    if(m_future.isRunning()) {
+        return;
+    }
+    m_cancelled.store(false);
+    m_future = QtConcurrent::run(&m_threadPool, this, &KLocalDirLister::list);
+}
+
+void KLocalDirLister::kill()
+{
+    m_cancelled.store(true);
+
+    // A suspended worker has to wake up to notice it's cancelled, and so do workers waiting for folders.
+    resume();
+    QMutexLocker locker(&m_foldersMutex);
+    m_foldersChanged.wakeAll();
+}
+
+void KLocalDirLister::suspend()
+{
+    QMutexLocker locker(&m_suspendMutex);
+    m_suspended = true;
+}
+
+void KLocalDirLister::resume()
+{
+    QMutexLocker locker(&m_suspendMutex);
+    m_suspended = false;
+    m_resumed.wakeAll();
+}
+
+void KLocalDirLister::waitWhileSuspended()
+{
+    QMutexLocker locker(&m_suspendMutex);
+    while(m_suspended && !m_cancelled.load()) {
+        m_resumed.wait(&m_suspendMutex);
+    }
+}
+
+bool KLocalDirLister::canList(const QString &path)
+{
+    return !path.isEmpty() && access(QFile::encodeName(path).constData(), R_OK | X_OK) == 0;
+}
+
+void KLocalDirLister::list()
+{
+    if(m_recursive) {
+        listRecursive();
+        return;
+    }
+
+    int error = listFolder(QByteArray(), 0);
+    if(m_cancelled.load()) {
+        error = ECANCELED;
+    }
+    emit result(error);
+}
+
+void KLocalDirLister::listRecursive()
+{
+    {
+        QMutexLocker locker(&m_foldersMutex);
+        m_folders.clear();
+        m_activeFolders = 1;
+    }
+
+    // The listed folder itself is the only one where an error counts, sub folders we can't read are skipped (like KIO does).
+    QList<QByteArray> subFolders;
+    int error = listFolder(QByteArray(), &subFolders);
+
+    if(!error) {
+        {
+            QMutexLocker locker(&m_foldersMutex);
+            m_folders = subFolders;
+            m_activeFolders = 0;
+        }
+
+        // This thread is one of the workers, the others run on the rest of our pool.
+        QList<QFuture<void> > workers;
+        for(int i = 1; i < MaxParallelFolders; i++) {
+            workers.append(QtConcurrent::run(&m_threadPool, this, &KLocalDirLister::listFolders));
+        }
+        listFolders();
+        for(QFuture<void>& worker : workers) {
+            worker.waitForFinished();
+        }
+    }
+
+    if(m_cancelled.load()) {
+        error = ECANCELED;
+    }
+    emit result(error);
+}
+
+void KLocalDirLister::listFolders()
+{
+    QMutexLocker locker(&m_foldersMutex);
+    while(true) {
+        // Nothing to do right now, but a folder that is being read might still add sub folders.
+        while(m_folders.isEmpty() && m_activeFolders > 0 && !m_cancelled.load()) {
+            m_foldersChanged.wait(&m_foldersMutex);
+        }
+        if(m_folders.isEmpty() || m_cancelled.load()) {
+            m_foldersChanged.wakeAll();
+            return;
+        }
+
+        const QByteArray folder = m_folders.takeFirst();
+        m_activeFolders++;
+        locker.unlock();
+
+        QList<QByteArray> subFolders;
+        listFolder(folder, &subFolders);
+
+        locker.relock();
+        m_folders.append(subFolders);
+        m_activeFolders--;
+        m_foldersChanged.wakeAll();
+    }
+}
+
+int KLocalDirLister::listFolder(const QByteArray &relativePath, QList<QByteArray> *subFolders)
+{
+    QByteArray path = QFile::encodeName(m_path);
+    if(!relativePath.isEmpty()) {
+        path += '/' + relativePath;
+    }
+
+    const int dirFd = open(path.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dirFd == -1) {
+        return errno;
+    }
+
+    // Entries in sub folders are named by their path relative to the listed folder, like KIO::listRecursive does.
+    const QString prefix = relativePath.isEmpty() ? QString() : QFile::decodeName(relativePath) + QLatin1Char('/');
+
+    KIO::UDSEntryList batch;
+    batch.reserve(BatchSize);
+
+    // Called for every name we read. Fills in the UDSEntry and sends the batch when it's full.
+    auto addEntry = [&](const char* name, unsigned char type) {
+        const bool isDotOrDotDot = name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+
+        // Only the listed folder has "." and "..", the sub folders would just repeat them.
+        if(isDotOrDotDot && !relativePath.isEmpty()) {
+            return;
+        }
+
+        KIO::UDSEntry entry;
+        entry.insert(KIO::UDSEntry::UDS_NAME, prefix + QFile::decodeName(name));
+
+        const mode_t fileType = fileTypeFromDirentType(type);
+        if(m_details || fileType == 0) {
+            if(!KLocalStat::stat(dirFd, QByteArray::fromRawData(name, qstrlen(name)), entry, m_details)) {
+                // Gone in the meantime or no permission. Still list it, like the file slave does.
+                entry.insert(KIO::UDSEntry::UDS_FILE_TYPE, S_IFREG);
+            }
+        } else {
+            entry.insert(KIO::UDSEntry::UDS_FILE_TYPE, fileType);
+        }
+
+        // Links to folders aren't followed, that could go round in circles.
+        if(subFolders && !isDotOrDotDot && entry.numberValue(KIO::UDSEntry::UDS_FILE_TYPE) == S_IFDIR
+           && !entry.contains(KIO::UDSEntry::UDS_LINK_DEST)) {
+            subFolders->append(relativePath.isEmpty() ? QByteArray(name) : relativePath + '/' + name);
+        }
+
+        batch.append(entry);
+        if(batch.count() >= BatchSize) {
+            emit entries(batch);
+            batch.clear();
+            batch.reserve(BatchSize);
+            waitWhileSuspended();
+        }
+    };
+
+    int error = 0;
+
+#ifdef Q_OS_LINUX
+    // 32 KB at a time, that's a few hundred names per syscall. The records are read in place, so the buffer is aligned like one.
+    alignas(linux_dirent64) char buffer[32 * 1024];
+    while(!m_cancelled.load()) {
+        const long numOfBytes = syscall(SYS_getdents64, dirFd, buffer, sizeof(buffer));
+        if(numOfBytes == -1) {
+            error = errno;
+            break;
+        }
+        if(numOfBytes == 0) {
+            break;
+        }
+
+        for(long offset = 0; offset < numOfBytes && !m_cancelled.load();) {
+            const linux_dirent64* dirent = reinterpret_cast<const linux_dirent64*>(buffer + offset);
+            addEntry(dirent->d_name, dirent->d_type);
+            offset += dirent->d_reclen;
+        }
+    }
+    close(dirFd);
+#else
+    DIR* dir = fdopendir(dirFd);
+    if(!dir) {
+        error = errno;
+        close(dirFd);
+    } else {
+        errno = 0;
+        while(!m_cancelled.load()) {
+            const dirent* ent = readdir(dir);
+            if(!ent) {
+                error = errno;
+                break;
+            }
+            addEntry(ent->d_name, ent->d_type);
+        }
+        closedir(dir); // Closes dirFd as well.
+    }
+#endif
+
+    if(!m_cancelled.load() && !batch.isEmpty()) {
+        emit entries(batch);
+    }
+
+    return error;
+}
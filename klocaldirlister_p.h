@@ -0,0 +1,128 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KLOCALDIRLISTER_P_H
+#define KLOCALDIRLISTER_P_H
+
+// Qt includes
+#include <QObject>
+#include <QString>
+#include <QFuture>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+
+// KDE includes
+#include <kio/udsentry.h>
+
+#include <atomic>
+
+/**
+ * Lists a local folder without going through KIO.
+ *
+ * The folder is read on a worker thread with openat + getdents64 (readdir on non Linux systems).
+ * The file type comes from d_type, so a listing without details ("0") doesn't need a single stat
+ * call. Only entries where the file system doesn't fill in d_type and symlinks are stat'ed. With
+ * details ("2") every entry is stat'ed relative to the folder fd, see KLocalStat.
+ *
+ * The entries are send in batches through the entries signal as KIO::UDSEntryList, exactly like
+ * KIO::ListJob does, so they go through the same pipeline in KDirectoryPrivate.
+ *
+ * A recursive lister lists all sub folders too, up to MaxParallelFolders at the same time. Just like
+ * KIO::listRecursive the names of entries in sub folders are paths relative to the listed folder.
+ *
+ * Every lister has it's own threads. A suspended lister blocks those, never the threads of
+ * other listers or the global QThreadPool.
+ */
+class KLocalDirLister : public QObject
+{
+    Q_OBJECT
+public:
+    // Number of entries per entries signal and the number of folders a recursive lister reads at the same time.
+    enum { BatchSize = 1000, MaxParallelFolders = 4 };
+
+    explicit KLocalDirLister(const QString& path, const QString& details, bool recursive = false, QObject* parent = 0);
+
+    /**
+     * Stops the worker and waits for it to be done. No signals are emitted after this.
+     */
+    ~KLocalDirLister();
+
+    /**
+     * Starts listing on a worker thread.
+     */
+    void start();
+
+    /**
+     * Stops listing as soon as possible. result is still emitted (with ECANCELED).
+     */
+    void kill();
+
+    /**
+     * Pauses the workers after the batch they are busy with, until resume() is called. Use this when
+     * the receiver can't keep up with the entries or something more important should go first.
+     * The workers wait on their own threads, see m_threadPool.
+     */
+    void suspend();
+    void resume();
+
+    /**
+     * Returns true if @p path is something we can list ourselves.
+     * @return bool
+     */
+    static bool canList(const QString& path);
+
+signals:
+    void entries(const KIO::UDSEntryList& entries);
+
+    /**
+     * Done listing.
+     * @param error 0 on success, otherwise the errno of what went wrong.
+     */
+    void result(int error);
+
+private:
+    void list();
+    void listRecursive();
+    void listFolders();
+    int listFolder(const QByteArray& relativePath, QList<QByteArray>* subFolders);
+    void waitWhileSuspended();
+
+    QString m_path;
+    bool m_details;
+    bool m_recursive;
+
+    // The workers of this lister only. Threads that aren't used for a while are given back to the system.
+    QThreadPool m_threadPool;
+    QFuture<void> m_future;
+    std::atomic<bool> m_cancelled;
+
+    // The worker waits on m_resumed while m_suspended is set.
+    QMutex m_suspendMutex;
+    QWaitCondition m_resumed;
+    bool m_suspended;
+
+    // The folders a recursive lister still has to read and the number of folders being read right now.
+    QMutex m_foldersMutex;
+    QWaitCondition m_foldersChanged;
+    QList<QByteArray> m_folders;
+    int m_activeFolders;
+};
+
+#endif // KLOCALDIRLISTER_P_H
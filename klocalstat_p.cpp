@@ -0,0 +1,204 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "klocalstat_p.h"
+
+// Qt includes
+#include <QFile>
+#include <QHash>
+#include <QGlobalStatic>
+#include <QReadWriteLock>
+#include <QReadLocker>
+#include <QWriteLocker>
+
+// System includes
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <grp.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    struct NameCache {
+        QReadWriteLock lock;
+        QHash<uint, QString> userNames;
+        QHash<uint, QString> groupNames;
+    };
+}
+
+Q_GLOBAL_STATIC(NameCache, s_nameCache)
+
+#if defined(Q_OS_LINUX) && defined(STATX_BASIC_STATS)
+// Set once statx turned out not to be there at runtime (an older kernel, or a sandbox that blocks it).
+static std::atomic<bool> s_statxUnavailable(false);
+#endif
+
+bool KLocalStat::stat(int dirFd, const QByteArray &name, KIO::UDSEntry &entry, bool details)
+{
+    mode_t mode = 0;
+    qint64 size = 0;
+    qint64 modificationTime = -1;
+    qint64 accessTime = -1;
+    qint64 creationTime = -1;
+    quint64 inode = 0;
+    uint uid = 0;
+    uint gid = 0;
+    bool statted = false;
+
+#if defined(Q_OS_LINUX) && defined(STATX_BASIC_STATS)
+    // statx lets us ask for just what we need and it knows the creation (birth) time.
+    // Being built against it doesn't mean the kernel we run on has it, ENOSYS sends us to fstatat below.
+    const unsigned int mask = details ? (STATX_BASIC_STATS | STATX_BTIME) : STATX_TYPE;
+    struct statx buff;
+    if(!s_statxUnavailable.load(std::memory_order_relaxed)) {
+        if(statx(dirFd, name.constData(), AT_SYMLINK_NOFOLLOW, mask, &buff) == 0) {
+            statted = true;
+        } else if(errno == ENOSYS) {
+            s_statxUnavailable.store(true, std::memory_order_relaxed);
+        } else {
+            return false;
+        }
+    }
+
+    if(statted) {
+        if(S_ISLNK(buff.stx_mode)) {
+            // Read the link target, then continue with what the link points to.
+            char target[PATH_MAX + 1];
+            const ssize_t length = readlinkat(dirFd, name.constData(), target, PATH_MAX);
+            if(length > 0) {
+                entry.insert(KIO::UDSEntry::UDS_LINK_DEST, QFile::decodeName(QByteArray(target, length)));
+            }
+
+            struct statx linkTarget;
+            if(statx(dirFd, name.constData(), 0, mask, &linkTarget) == 0) {
+                buff = linkTarget;
+            }
+        }
+
+        mode = buff.stx_mode;
+        size = buff.stx_size;
+        modificationTime = buff.stx_mtime.tv_sec;
+        accessTime = buff.stx_atime.tv_sec;
+        if(buff.stx_mask & STATX_BTIME) {
+            creationTime = buff.stx_btime.tv_sec;
+        }
+        inode = buff.stx_ino;
+        uid = buff.stx_uid;
+        gid = buff.stx_gid;
+    }
+#endif
+
+    if(!statted) {
+        struct stat buff;
+        if(fstatat(dirFd, name.constData(), &buff, AT_SYMLINK_NOFOLLOW) == -1) {
+            return false;
+        }
+
+        if(S_ISLNK(buff.st_mode)) {
+            // Read the link target, then continue with what the link points to.
+            char target[PATH_MAX + 1];
+            const ssize_t length = readlinkat(dirFd, name.constData(), target, PATH_MAX);
+            if(length > 0) {
+                entry.insert(KIO::UDSEntry::UDS_LINK_DEST, QFile::decodeName(QByteArray(target, length)));
+            }
+
+            struct stat linkTarget;
+            if(fstatat(dirFd, name.constData(), &linkTarget, 0) == 0) {
+                buff = linkTarget;
+            }
+        }
+
+        mode = buff.st_mode;
+        size = buff.st_size;
+        modificationTime = buff.st_mtime;
+        accessTime = buff.st_atime;
+        inode = buff.st_ino;
+        uid = buff.st_uid;
+        gid = buff.st_gid;
+    }
+
+    entry.insert(KIO::UDSEntry::UDS_FILE_TYPE, mode & S_IFMT);
+    if(!details) {
+        return true;
+    }
+
+    entry.insert(KIO::UDSEntry::UDS_ACCESS, mode & 07777);
+    entry.insert(KIO::UDSEntry::UDS_SIZE, size);
+    entry.insert(KIO::UDSEntry::UDS_MODIFICATION_TIME, modificationTime);
+    entry.insert(KIO::UDSEntry::UDS_ACCESS_TIME, accessTime);
+    if(creationTime != -1) {
+        entry.insert(KIO::UDSEntry::UDS_CREATION_TIME, creationTime);
+    }
+    entry.insert(KIO::UDSEntry::UDS_INODE, inode);
+    entry.insert(KIO::UDSEntry::UDS_USER, userName(uid));
+    entry.insert(KIO::UDSEntry::UDS_GROUP, groupName(gid));
+    return true;
+}
+
+QString KLocalStat::userName(uint uid)
+{
+    // Almost every file in a folder has the same owner, so this is looked up once.
+    NameCache* cache = s_nameCache();
+    {
+        QReadLocker locker(&cache->lock);
+        QHash<uint, QString>::const_iterator it = cache->userNames.constFind(uid);
+        if(it != cache->userNames.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QString name = QString::number(uid);
+    passwd pwd;
+    passwd* result = 0;
+    char buffer[4096];
+    if(getpwuid_r(uid, &pwd, buffer, sizeof(buffer), &result) == 0 && result) {
+        name = QString::fromLocal8Bit(result->pw_name);
+    }
+
+    QWriteLocker locker(&cache->lock);
+    cache->userNames.insert(uid, name);
+    return name;
+}
+
+QString KLocalStat::groupName(uint gid)
+{
+    NameCache* cache = s_nameCache();
+    {
+        QReadLocker locker(&cache->lock);
+        QHash<uint, QString>::const_iterator it = cache->groupNames.constFind(gid);
+        if(it != cache->groupNames.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QString name = QString::number(gid);
+    group grp;
+    group* result = 0;
+    char buffer[4096];
+    if(getgrgid_r(gid, &grp, buffer, sizeof(buffer), &result) == 0 && result) {
+        name = QString::fromLocal8Bit(result->gr_name);
+    }
+
+    QWriteLocker locker(&cache->lock);
+    cache->groupNames.insert(gid, name);
+    return name;
+}
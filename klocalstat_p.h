@@ -0,0 +1,56 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KLOCALSTAT_P_H
+#define KLOCALSTAT_P_H
+
+// Qt includes
+#include <QString>
+#include <QByteArray>
+
+// KDE includes
+#include <kio/udsentry.h>
+
+/**
+ * Stat calls for local files, relative to an open folder fd, filling in the same UDSEntry fields
+ * as the file kioslave does. Used by KLocalDirLister and KStatEngine. Everything in here is
+ * thread safe.
+ */
+class KLocalStat
+{
+public:
+    /**
+     * Stats @p name in the folder @p dirFd and puts the result in @p entry. statx is used where
+     * available (that gives us the creation time as well), fstatat otherwise. That includes builds
+     * with statx that run on a kernel without it (ENOSYS), checked once per process. Symlinks get
+     * UDS_LINK_DEST and the type of what they point to.
+     * @param details if false only the file type (and link destination) is filled in.
+     * @return false if the file couldn't be stat'ed, @p entry is left alone in that case.
+     */
+    static bool stat(int dirFd, const QByteArray& name, KIO::UDSEntry& entry, bool details);
+
+    /**
+     * User and group name for an id. Looked up once per id for the whole process.
+     * @return QString the name, or the id as string if there is no name for it.
+     */
+    static QString userName(uint uid);
+    static QString groupName(uint gid);
+};
+
+#endif // KLOCALSTAT_P_H
@@ -0,0 +1,146 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "kmimetyperegistry.h"
+
+#include <QGlobalStatic>
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QWriteLocker>
+
+Q_GLOBAL_STATIC(KMimeTypeRegistry, s_mimeTypeRegistry)
+
+KMimeTypeRegistry::KMimeTypeRegistry()
+    : m_count(0)
+    , m_lookupLock()
+    , m_idForExtension()
+    , m_idForName()
+    , m_directoryId(InvalidId)
+    , m_internMutex()
+    , m_db()
+{
+    for(std::atomic<StaticMimeType*>& chunk : m_chunks) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+
+    // The first chunk always exists. It's first element is the invalid mime type (id 0).
+    m_chunks[0].store(new StaticMimeType[ChunkSize], std::memory_order_release);
+    m_count.store(1, std::memory_order_release);
+
+    // Folders are so common that they get their id right away.
+    m_directoryId = intern(m_db.mimeTypeForName(QStringLiteral("inode/directory")));
+}
+
+KMimeTypeRegistry::~KMimeTypeRegistry()
+{
+    for(std::atomic<StaticMimeType*>& chunk : m_chunks) {
+        delete [] chunk.load(std::memory_order_acquire);
+    }
+}
+
+KMimeTypeRegistry *KMimeTypeRegistry::self()
+{
+    return s_mimeTypeRegistry();
+}
+
+int KMimeTypeRegistry::idForFile(const QString &fileName, const QString &extension, bool isDir)
+{
+    if(isDir) {
+        return m_directoryId;
+    }
+
+    // Without an extension the full name might still match a glob (Makefile, README, ...). Those aren't cached by name
+    // since a folder can have a lot of unique names without extension. The glob lookup itself is cheap (no file access).
+    if(extension.isEmpty()) {
+        return idForMimeType(m_db.mimeTypeForFile(fileName, QMimeDatabase::MatchExtension));
+    }
+
+    {
+        QReadLocker locker(&m_lookupLock);
+        QHash<QString, int>::const_iterator it = m_idForExtension.constFind(extension);
+        if(it != m_idForExtension.constEnd()) {
+            return it.value();
+        }
+    }
+
+    // Resolve on a made up name so that the result only depends on the extension, not on the first file that came by.
+    const int id = idForMimeType(m_db.mimeTypeForFile(QStringLiteral("file.") + extension, QMimeDatabase::MatchExtension));
+
+    QWriteLocker locker(&m_lookupLock);
+    m_idForExtension.insert(extension, id);
+    return id;
+}
+
+int KMimeTypeRegistry::idForMimeType(const QMimeType &mime)
+{
+    if(!mime.isValid()) {
+        return InvalidId;
+    }
+
+    {
+        QReadLocker locker(&m_lookupLock);
+        QHash<QString, int>::const_iterator it = m_idForName.constFind(mime.name());
+        if(it != m_idForName.constEnd()) {
+            return it.value();
+        }
+    }
+
+    return intern(mime);
+}
+
+const StaticMimeType &KMimeTypeRegistry::mimeType(int id) const
+{
+    if(id <= InvalidId || id >= m_count.load(std::memory_order_acquire)) {
+        return m_chunks[0].load(std::memory_order_acquire)[InvalidId];
+    }
+    return m_chunks[id / ChunkSize].load(std::memory_order_acquire)[id % ChunkSize];
+}
+
+int KMimeTypeRegistry::intern(const QMimeType &mime)
+{
+    QMutexLocker internLocker(&m_internMutex);
+
+    // Another thread might have interned the same mime type while we where waiting for the mutex.
+    {
+        QReadLocker locker(&m_lookupLock);
+        QHash<QString, int>::const_iterator it = m_idForName.constFind(mime.name());
+        if(it != m_idForName.constEnd()) {
+            return it.value();
+        }
+    }
+
+    const int id = m_count.load(std::memory_order_relaxed);
+    if(id >= ChunkSize * MaxChunks) {
+        return InvalidId;
+    }
+
+    StaticMimeType* chunk = m_chunks[id / ChunkSize].load(std::memory_order_relaxed);
+    if(!chunk) {
+        chunk = new StaticMimeType[ChunkSize];
+        m_chunks[id / ChunkSize].store(chunk, std::memory_order_release);
+    }
+
+    // Fill in the mime type before publishing the new count. Readers never look past the count.
+    chunk[id % ChunkSize] = StaticMimeType(mime);
+    m_count.store(id + 1, std::memory_order_release);
+
+    QWriteLocker locker(&m_lookupLock);
+    m_idForName.insert(mime.name(), id);
+    return id;
+}
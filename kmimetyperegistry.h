@@ -0,0 +1,107 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KMIMETYPEREGISTRY_H
+#define KMIMETYPEREGISTRY_H
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QMimeDatabase>
+
+#include <atomic>
+
+#include "staticmimetype.h"
+
+/**
+ * Process wide registry of the mime types we've seen.
+ *
+ * Every mime type that is resolved gets interned as a StaticMimeType with a small integer id.
+ * Entries only store that id. Resolving an id back to the icon name or comment (mimeType())
+ * is lock free and can be done from any thread. Ids are never reused or moved, so a reference
+ * returned by mimeType() stays valid for the lifetime of the process.
+ *
+ * Resolving a file name to an id (idForFile()) only takes a lock when the extension hasn't
+ * been seen before.
+ */
+class KMimeTypeRegistry
+{
+public:
+    // Id 0 is the invalid (unknown) mime type. It has empty strings for everything.
+    enum { InvalidId = 0 };
+
+    // The maximum number of distinct mime types. Ids fit in a quint16.
+    enum { ChunkSize = 256, MaxChunks = 256 };
+
+    KMimeTypeRegistry();
+    ~KMimeTypeRegistry();
+
+    static KMimeTypeRegistry* self();
+
+    /**
+     * Returns the mime type id for a file. The lookup is based on the extension. Folders all
+     * get the inode/directory mime type.
+     * @param fileName the name of the file, only used if the extension is empty.
+     * @param extension the extension of the file without leading dot.
+     * @param isDir true if the entry is a folder.
+     * @return int the mime type id
+     */
+    int idForFile(const QString& fileName, const QString& extension, bool isDir);
+
+    /**
+     * Returns the id for @p mime, interning it if needed.
+     * @return int the mime type id
+     */
+    int idForMimeType(const QMimeType& mime);
+
+    /**
+     * Returns the mime type for @p id. This is lock free and can be called from any thread.
+     * @return StaticMimeType. The invalid mime type if the id is unknown.
+     */
+    const StaticMimeType& mimeType(int id) const;
+
+    /**
+     * Number of interned mime types (including the invalid one).
+     * @return int
+     */
+    int count() const { return m_count.load(std::memory_order_acquire); }
+
+private:
+    int intern(const QMimeType& mime);
+
+    // Mime types are stored in fixed size chunks that never move. Readers only need the
+    // (atomic) count to know which ids are safe to read.
+    std::atomic<StaticMimeType*> m_chunks[MaxChunks];
+    std::atomic<int> m_count;
+
+    // Protects the id lookup tables below. The ids themselves are read without this lock.
+    mutable QReadWriteLock m_lookupLock;
+    QHash<QString, int> m_idForExtension;
+    QHash<QString, int> m_idForName;
+    int m_directoryId;
+
+    // Serializes interning new mime types.
+    QMutex m_internMutex;
+
+    // QMimeDatabase is thread safe, one instance is all we need.
+    QMimeDatabase m_db;
+};
+
+#endif // KMIMETYPEREGISTRY_H
@@ -0,0 +1,135 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "kstatengine_p.h"
+#include "klocalstat_p.h"
+
+// Qt includes
+#include <QFile>
+#include <QMetaType>
+#include <QMutexLocker>
+#include <QTimer>
+
+#include "ThreadPool.h"
+
+// System includes
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    // One pool for every engine in the process. Stat calls are I/O bound, a few threads keep the disk busy enough.
+    ThreadPool& statPool()
+    {
+        static ThreadPool pool(KStatEngine::NumOfWorkers);
+        return pool;
+    }
+}
+
+KStatEngine::Shared::Shared(int dirFd)
+    : dirFd(dirFd)
+    , cancelled(false)
+    , mutex()
+    , engine(0)
+{
+}
+
+KStatEngine::Shared::~Shared()
+{
+    // The last batch using the fd is done.
+    if(dirFd != -1) {
+        close(dirFd);
+    }
+}
+
+KStatEngine::KStatEngine(const QString &path, QObject *parent)
+    : QObject(parent)
+    , m_shared(std::make_shared<Shared>(open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)))
+    , m_pending()
+    , m_flushScheduled(false)
+{
+    // The signals cross from the worker threads to the thread we live in.
+    qRegisterMetaType<KIO::UDSEntryList>("KIO::UDSEntryList");
+    m_shared->engine = this;
+}
+
+KStatEngine::~KStatEngine()
+{
+    // Batches that are still queued return right away now. One that is emitting holds the mutex, after this it won't find us anymore.
+    m_shared->cancelled.store(true);
+    QMutexLocker locker(&m_shared->mutex);
+    m_shared->engine = 0;
+}
+
+void KStatEngine::request(const QString &name)
+{
+    if(!isValid()) {
+        return;
+    }
+
+    m_pending.append(name);
+
+    // Everything that comes in during this event loop iteration (a view asking for all visible rows) ends up in the same flush.
+    if(!m_flushScheduled) {
+        m_flushScheduled = true;
+        QTimer::singleShot(0, this, SLOT(flush()));
+    }
+}
+
+void KStatEngine::flush()
+{
+    m_flushScheduled = false;
+
+    const int numOfPending = m_pending.count();
+    for(int i = 0; i < numOfPending; i += MaxBatchSize) {
+        statPool().enqueue(&KStatEngine::statBatch, m_shared, m_pending.mid(i, MaxBatchSize));
+    }
+    m_pending.clear();
+}
+
+void KStatEngine::statBatch(std::shared_ptr<Shared> shared, const QStringList &names)
+{
+    KIO::UDSEntryList entries;
+    entries.reserve(names.count());
+    QStringList failed;
+
+    for(const QString& name : names) {
+        if(shared->cancelled.load()) {
+            return;
+        }
+
+        KIO::UDSEntry entry;
+        if(KLocalStat::stat(shared->dirFd, QFile::encodeName(name), entry, true)) {
+            entry.insert(KIO::UDSEntry::UDS_NAME, name);
+            entries.append(entry);
+        } else {
+            failed.append(name);
+        }
+    }
+
+    QMutexLocker locker(&shared->mutex);
+    if(!shared->engine) {
+        return;
+    }
+    if(!entries.isEmpty()) {
+        emit shared->engine->entriesStatted(entries);
+    }
+    if(!failed.isEmpty()) {
+        emit shared->engine->entriesFailed(failed);
+    }
+}
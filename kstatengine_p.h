@@ -0,0 +1,106 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KSTATENGINE_P_H
+#define KSTATENGINE_P_H
+
+// Qt includes
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+
+// KDE includes
+#include <kio/udsentry.h>
+
+#include <atomic>
+#include <memory>
+
+/**
+ * Loads the details of entries in one local folder.
+ *
+ * The folder is opened once (O_DIRECTORY) and every file is stat'ed relative to that fd on a
+ * small pool of worker threads, see KLocalStat. That pool is shared by all engines in the process,
+ * so the number of threads doesn't grow with the number of folders.
+ *
+ * Requests that come in during one event loop iteration are collected and split in batches of
+ * at most MaxBatchSize names. Every batch is delivered back as one entriesStatted signal, not one
+ * signal per file.
+ */
+class KStatEngine : public QObject
+{
+    Q_OBJECT
+public:
+    enum { MaxBatchSize = 256, NumOfWorkers = 4 };
+
+    explicit KStatEngine(const QString& path, QObject* parent = 0);
+
+    /**
+     * Cancels what is still queued. A batch that is running is not waited for, but no signals are emitted after this.
+     */
+    ~KStatEngine();
+
+    /**
+     * Returns false if the folder couldn't be opened. Requests are ignored in that case.
+     * @return bool
+     */
+    bool isValid() const { return m_shared->dirFd != -1; }
+
+    /**
+     * Queues a stat for the file @p name in this folder.
+     */
+    void request(const QString& name);
+
+signals:
+    /**
+     * A batch is done.
+     * @param entries full details (as if listed with details "2") for every file that could be stat'ed.
+     */
+    void entriesStatted(const KIO::UDSEntryList& entries);
+
+    /**
+     * @param names the files from a batch that couldn't be stat'ed.
+     */
+    void entriesFailed(const QStringList& names);
+
+private slots:
+    void flush();
+
+private:
+    // What the batches on the worker threads need. It lives till the last batch is done, which can be after we are gone.
+    struct Shared {
+        explicit Shared(int dirFd);
+        ~Shared();
+
+        int dirFd;
+        std::atomic<bool> cancelled;
+
+        // The engine to report to, 0 once it's deleted. Held while emitting.
+        QMutex mutex;
+        KStatEngine* engine;
+    };
+
+    static void statBatch(std::shared_ptr<Shared> shared, const QStringList& names);
+
+    std::shared_ptr<Shared> m_shared;
+    QStringList m_pending;
+    bool m_flushScheduled;
+};
+
+#endif // KSTATENGINE_P_H
@@ -0,0 +1,204 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "kstatscheduler_p.h"
+
+#include <algorithm>
+
+KStatScheduler::KStatScheduler()
+    : m_queued()
+    , m_inFlight()
+    , m_done()
+    , m_failed()
+    , m_requestRows()
+    , m_queue()
+    , m_visibleFirst(-1)
+    , m_visibleLast(-1)
+    , m_inFlightCount(0)
+{
+}
+
+bool KStatScheduler::request(int id, int row)
+{
+    if(id < 0) {
+        return false;
+    }
+
+    ensureSize(id);
+    if(m_queued.testBit(id) || m_inFlight.testBit(id) || m_done.testBit(id) || m_failed.testBit(id)) {
+        return false;
+    }
+
+    m_queued.setBit(id);
+    m_requestRows[id] = row;
+    m_queue.push_back(id);
+    std::push_heap(m_queue.begin(), m_queue.end(), FurtherAway(this));
+    return true;
+}
+
+void KStatScheduler::setVisibleRange(int first, int last)
+{
+    if(first == m_visibleFirst && last == m_visibleLast) {
+        return;
+    }
+
+    m_visibleFirst = first;
+    m_visibleLast = last;
+
+    // Rows that scrolled by during a fling asked for their details too. Drop those, they aren't on screen anymore.
+    std::vector<int>::iterator end = std::remove_if(m_queue.begin(), m_queue.end(), [this](int id) {
+        if(isNearVisibleRange(id)) {
+            return false;
+        }
+        m_queued.clearBit(id);
+        return true;
+    });
+    m_queue.erase(end, m_queue.end());
+
+    // The distances changed, so the heap has to be rebuilt.
+    std::make_heap(m_queue.begin(), m_queue.end(), FurtherAway(this));
+}
+
+QVector<int> KStatScheduler::takeNext()
+{
+    QVector<int> ids;
+    while(!m_queue.empty() && m_inFlightCount < MaxInFlight) {
+        std::pop_heap(m_queue.begin(), m_queue.end(), FurtherAway(this));
+        const int id = m_queue.back();
+        m_queue.pop_back();
+
+        m_queued.clearBit(id);
+        m_inFlight.setBit(id);
+        m_inFlightCount++;
+        ids.append(id);
+    }
+    return ids;
+}
+
+void KStatScheduler::finished(int id, bool ok)
+{
+    m_inFlightCount = qMax(0, m_inFlightCount - 1);
+
+    if(id < 0 || id >= m_inFlight.size()) {
+        return;
+    }
+
+    m_inFlight.clearBit(id);
+    if(ok) {
+        m_done.setBit(id);
+    } else {
+        m_failed.setBit(id);
+    }
+}
+
+void KStatScheduler::forget(int id)
+{
+    if(id >= 0 && id < m_done.size()) {
+        m_done.clearBit(id);
+        m_failed.clearBit(id);
+    }
+}
+
+void KStatScheduler::remove(const QVector<int> &ids)
+{
+    if(ids.isEmpty()) {
+        return;
+    }
+
+    // The new id of every id we know about, -1 for the removed ones.
+    const int size = m_queued.size();
+    QVector<int> newIds(size);
+    int next = 0;
+    for(int id = 0; id < size; id++) {
+        if(next < ids.count() && ids.at(next) == id) {
+            next++;
+            newIds[id] = -1;
+        } else {
+            newIds[id] = id - next;
+        }
+    }
+
+    // Queued requests stay queued under their new id, the ones of removed entries are dropped.
+    std::vector<int> queue;
+    queue.reserve(m_queue.size());
+    for(const int id : m_queue) {
+        if(newIds.at(id) != -1) {
+            queue.push_back(newIds.at(id));
+        }
+    }
+    m_queue.swap(queue);
+
+    // Ids only go down, so everything can be moved in place. The ids that are left at the end are cleared.
+    for(int id = 0; id < size; id++) {
+        const int newId = newIds.at(id);
+        if(newId == -1 || newId == id) {
+            continue;
+        }
+        m_queued.setBit(newId, m_queued.testBit(id));
+        m_inFlight.setBit(newId, m_inFlight.testBit(id));
+        m_done.setBit(newId, m_done.testBit(id));
+        m_failed.setBit(newId, m_failed.testBit(id));
+        m_requestRows[newId] = m_requestRows.at(id);
+    }
+    for(int id = size - next; id < size; id++) {
+        m_queued.clearBit(id);
+        m_inFlight.clearBit(id);
+        m_done.clearBit(id);
+        m_failed.clearBit(id);
+    }
+
+    std::make_heap(m_queue.begin(), m_queue.end(), FurtherAway(this));
+}
+
+int KStatScheduler::distance(int id) const
+{
+    // Without a view the entries simply go from the top down.
+    const int row = m_requestRows.at(id);
+    if(m_visibleFirst < 0) {
+        return row;
+    }
+    if(row < m_visibleFirst) {
+        return m_visibleFirst - row;
+    }
+    if(row > m_visibleLast) {
+        return row - m_visibleLast;
+    }
+    return 0;
+}
+
+bool KStatScheduler::isNearVisibleRange(int id) const
+{
+    const int row = m_requestRows.at(id);
+    return m_visibleFirst < 0 || (row >= m_visibleFirst - VisibleMargin && row <= m_visibleLast + VisibleMargin);
+}
+
+void KStatScheduler::ensureSize(int id)
+{
+    if(id < m_queued.size()) {
+        return;
+    }
+
+    // Grow in steps, entries come in by the thousands while listing.
+    const int size = qMax(id + 1, m_queued.size() * 2);
+    m_queued.resize(size);
+    m_inFlight.resize(size);
+    m_done.resize(size);
+    m_failed.resize(size);
+    m_requestRows.resize(size);
+}
@@ -0,0 +1,125 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef KSTATSCHEDULER_P_H
+#define KSTATSCHEDULER_P_H
+
+#include <QBitArray>
+#include <QVector>
+
+#include <vector>
+
+/**
+ * Decides which entries get their details loaded next.
+ *
+ * Requests are kept in a priority queue ordered by the distance of the entry to the visible
+ * range (setVisibleRange), so whatever is on screen is stat'ed first. When the visible range
+ * moves, queued requests that are far away from it are dropped: the view asks again if those
+ * rows ever come back. Entries that are done, or failed to stat, are remembered and not requested
+ * again. All of that moves along when the ids change (remove).
+ *
+ * Ids are indexes in the entry store, those don't change when the rows are sorted. The distance
+ * is measured with the row the entry had when it was requested.
+ *
+ * The scheduler only keeps the bookkeeping, it doesn't stat anything itself. Use takeNext()
+ * to get the entries to stat and finished() once they are done.
+ */
+class KStatScheduler
+{
+public:
+    // Rows before and after the visible range that are still kept in the queue when the view moves.
+    // MaxInFlight is the number of entries that is being stat'ed at the same time. That is about one
+    // KStatEngine batch: once handed out a request can't be dropped anymore, so the rest has to stay
+    // queued for a scroll to be able to cancel it.
+    enum { VisibleMargin = 64, MaxInFlight = 256 };
+
+    KStatScheduler();
+
+    /**
+     * Queues entry @p id, which is shown at @p row.
+     * @return bool false if the entry is already queued, being stat'ed, done or failed before.
+     */
+    bool request(int id, int row);
+
+    /**
+     * Sets the entries the view currently shows and drops queued requests that aren't near it anymore.
+     * Pass -1 for both to show that there is no view, then nothing is dropped.
+     */
+    void setVisibleRange(int first, int last);
+
+    /**
+     * Takes the most important queued entries, as many as there is room for (see MaxInFlight).
+     * The entries are marked as being stat'ed.
+     * @return QVector<int> the ids, nearest to the visible range first.
+     */
+    QVector<int> takeNext();
+
+    /**
+     * Marks a stat as done.
+     * @param id the current id of the entry, -1 if the entry is gone in the meantime.
+     * @param ok false if the stat failed.
+     */
+    void finished(int id, bool ok);
+
+    /**
+     * Entry @p id changed (a relist or KDirWatch replaced it), it may be requested again even if it
+     * was done or failed before.
+     */
+    void forget(int id);
+
+    /**
+     * The entries @p ids (ascending) are removed, the ids after them shift down. Everything the
+     * scheduler knows about the other entries moves along with them. Stats of removed entries that
+     * are running keep counting until they are finished() with -1.
+     */
+    void remove(const QVector<int>& ids);
+
+    bool hasPending() const { return !m_queue.empty(); }
+    int inFlightCount() const { return m_inFlightCount; }
+
+private:
+    // Heap order: the entry nearest to the visible range ends up on top.
+    struct FurtherAway {
+        explicit FurtherAway(const KStatScheduler* scheduler) : scheduler(scheduler) {}
+        bool operator()(int a, int b) const { return scheduler->distance(a) > scheduler->distance(b); }
+        const KStatScheduler* scheduler;
+    };
+
+    int distance(int id) const;
+    bool isNearVisibleRange(int id) const;
+    void ensureSize(int id);
+
+    // One bit per entry id.
+    QBitArray m_queued;
+    QBitArray m_inFlight;
+    QBitArray m_done;
+    QBitArray m_failed;
+
+    // The row of each queued id, see request().
+    QVector<int> m_requestRows;
+
+    // Heap of queued ids, nearest to the visible range on top.
+    std::vector<int> m_queue;
+
+    int m_visibleFirst;
+    int m_visibleLast;
+    int m_inFlightCount;
+};
+
+#endif // KSTATSCHEDULER_P_H
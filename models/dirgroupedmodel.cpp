@@ -28,6 +28,8 @@ DirGroupedModel::DirGroupedModel(QObject *parent)
     , m_lister(0)
     , m_groupby()
     , m_distinctGroupKey()
+    , m_groupForCode()
+    , m_groupForNumber()
     , m_groupList()
     , m_currentRowCount(0)
     , m_currentEntryRowCount(0)
@@ -55,12 +57,8 @@ void DirGroupedModel::setPath(const QString &path)
         clearAdministrativeData();
         endRemoveRows();
 
-        // if we where already listing this folder then we need to jumpstart this model.
-        if(m_lister->isListing(path)) {
-            slotDirectoryContentChanged(m_lister->directory(path));
-        }
-
         // Now set the new path. From there on the slotDirectoryContentChanged should take over if more details flow in.
+        // If the lister already had this folder, what it has so far comes in with the first slotDirectoryContentChanged.
         m_listModel->setPath(path);
     }
 }
@@ -113,7 +111,7 @@ QVariant DirGroupedModel::data(const QModelIndex &index, int role) const
 
 void DirGroupedModel::slotDirectoryContentChanged(KDirectory *dir)
 {
-    connect(dir, &KDirectory::entryDetailsChanged, this, &DirGroupedModel::processEntry, Qt::UniqueConnection);
+    connect(dir, &KDirectory::entriesDetailsChanged, this, &DirGroupedModel::processEntries, Qt::UniqueConnection);
 
     // We don't need to figure out the groups if we're not using groups to begin with.
     if(m_groupby == DirListModel::None) {
@@ -130,7 +128,7 @@ void DirGroupedModel::slotDirectoryContentChanged(KDirectory *dir)
         return;
     }
 
-    int currentEntryCount = dir->entries().count();
+    int currentEntryCount = dir->count();
     for(int i = m_currentEntryRowCount; i < currentEntryCount; i++) {
         processEntry(dir, i);
     }
@@ -149,15 +147,68 @@ void DirGroupedModel::slotCompleted(KDirectory *dir)
 void DirGroupedModel::clearAdministrativeData()
 {
     m_distinctGroupKey.clear();
+    m_groupForCode.clear();
+    m_groupForNumber.clear();
     m_groupList.clear();
     m_currentRowCount = 0;
     m_currentEntryRowCount = 0;
 }
 
+void DirGroupedModel::processEntries(KDirectory *dir, const KDirectoryRanges &ranges)
+{
+    // Entries that got their details might end up in a group that doesn't exist yet.
+    for(const KDirectoryRange& range : ranges) {
+        for(int id = range.first; id <= range.last; id++) {
+            processEntry(dir, id);
+        }
+    }
+}
+
 void DirGroupedModel::processEntry(KDirectory *dir, int id)
 {
+    // Roles that are dictionary encoded in the entry store are grouped on their code. That is a simple
+    // vector lookup instead of comparing the new QVariant against every known group key.
+    const int column = DirListModel::dictionaryColumn(m_groupby);
+    if(column >= 0) {
+        const KDirectoryEntryStore::DictionaryColumn dictColumn = static_cast<KDirectoryEntryStore::DictionaryColumn>(column);
+        // Without details user and group are the empty string, that isn't a group. The entry comes back through
+        // entriesDetailsChanged once they are loaded.
+        const int index = dir->entryIndex(id);
+        if((m_groupby == DirListModel::User || m_groupby == DirListModel::Group) && !dir->entries().detailsLoaded(index)) {
+            dir->loadEntryDetails(id);
+            return;
+        }
+
+        const int code = dir->entries().code(index, dictColumn);
+        while(m_groupForCode.count() <= code) {
+            m_groupForCode.append(-1);
+        }
+
+        if(m_groupForCode.at(code) == -1) {
+            m_groupForCode[code] = m_distinctGroupKey.count();
+            addGroup(dir->entries().dictionary(dictColumn).value(code));
+        }
+        return;
+    }
+
+    // Size and times are grouped on their raw number. The QVariant (with a QDateTime for the times) that the
+    // group model filters on is only created once per new group.
+    if(DirListModel::isNumericRole(m_groupby)) {
+        // -1 means the details aren't loaded yet (they are asked for now), data() has no value for those either.
+        // Like user and group the entry is processed again from entriesDetailsChanged.
+        const qint64 number = m_listModel->numericValue(id, m_groupby);
+        if(number == -1) {
+            return;
+        }
+        if(!m_groupForNumber.contains(number)) {
+            m_groupForNumber.insert(number, m_distinctGroupKey.count());
+            addGroup(m_listModel->data(id, m_groupby));
+        }
+        return;
+    }
+
     QVariant potentialNewGroupKey;
-    const KDirectoryEntry& e = dir->entry(id);
+    const KDirectoryEntry e = dir->entry(id);
     switch (m_groupby) {
     case DirListModel::Name:
         potentialNewGroupKey = e.name();
@@ -208,19 +259,24 @@ void DirGroupedModel::processEntry(KDirectory *dir, int id)
     // Specially don't check for potentialNewGroupKey.isNull() because you might very group on something where empty would be valid.
     // For example, grouping on extension leaves out folders since they don't have an extension.
     if(!m_distinctGroupKey.contains(potentialNewGroupKey)) {
-        qDebug() << "insert row." << m_currentRowCount << m_distinctGroupKey.count() << m_distinctGroupKey;
-        beginInsertRows(QModelIndex(), m_currentRowCount, m_distinctGroupKey.count());
-        DirGroupedProxyModel* model = new DirGroupedProxyModel(this);
-        model->setFilterRole(m_groupby);
-        model->setRoleValueMatch(potentialNewGroupKey);
-        model->setSourceModel(m_listModel);
-        m_groupList << model;
-        m_distinctGroupKey << potentialNewGroupKey;
-        m_currentRowCount = m_distinctGroupKey.count();
-        endInsertRows();
+        addGroup(potentialNewGroupKey);
     }
 }
 
+void DirGroupedModel::addGroup(const QVariant &groupKey)
+{
+    qDebug() << "insert row." << m_currentRowCount << m_distinctGroupKey.count();
+    beginInsertRows(QModelIndex(), m_currentRowCount, m_distinctGroupKey.count());
+    DirGroupedProxyModel* model = new DirGroupedProxyModel(this);
+    model->setFilterRole(m_groupby);
+    model->setRoleValueMatch(groupKey);
+    model->setSourceModel(m_listModel);
+    m_groupList << model;
+    m_distinctGroupKey << groupKey;
+    m_currentRowCount = m_distinctGroupKey.count();
+    endInsertRows();
+}
+
 void DirGroupedModel::regroup()
 {
     if(!m_listModel->m_dir) {
@@ -23,6 +23,7 @@
 #include <QAbstractListModel>
 #include <QList>
 #include <QVector>
+#include <QHash>
 #include <QVariant>
 #include "dirlistmodel.h"
 #include "dirgroupedproxymodel.h"
@@ -65,6 +66,8 @@ public:
     void clearAdministrativeData();
 
     void processEntry(KDirectory *dir, int id);
+    void processEntries(KDirectory *dir, const KDirectoryRanges& ranges);
+    void addGroup(const QVariant& groupKey);
     Q_INVOKABLE void regroup();
 
     Q_INVOKABLE DirGroupedProxyModel* modelAtIndex(int index);
@@ -86,6 +89,8 @@ private:
     KDirListerV2* m_lister;
     DirListModel::Roles m_groupby;
     QVector<QVariant> m_distinctGroupKey; // The key you group in - mime for example - can and likely will occur multiple times. This vector just stores the same keys but without duplicates.
+    QVector<int> m_groupForCode; // For dictionary encoded roles: the group index per dictionary code or -1 if there is no group yet.
+    QHash<qint64, int> m_groupForNumber; // For Size and the times: the group index per raw value.
     QList<DirGroupedProxyModel*> m_groupList; // This stores a DirListModel per grouped component. This is what views will use to display a "group".
     int m_currentRowCount;
     int m_currentEntryRowCount;
@@ -42,13 +42,17 @@ DirListModel::DirListModel(QObject *parent)
 
 DirListModel::~DirListModel()
 {
-    // Delete pointers...
+    releaseDirectory();
 }
 
 void DirListModel::setPath(const QString &path, bool reload)
 {
     if(m_path != path) {
         m_path = path;
+
+        // We don't show the old folder anymore. If it's still being listed, that listing is cancelled.
+        releaseDirectory();
+
         beginResetModel();
 //        beginRemoveRows(QModelIndex(), 0, m_currentRowCount);
         m_currentRowCount = 0;
@@ -57,20 +61,18 @@ void DirListModel::setPath(const QString &path, bool reload)
         emit pathChanged();
     }
 
-    if(reload || !m_lister.isListing(m_path)) {
-        KDirListerV2::DirectoryFetchDetails dirFetchDetails;
-        dirFetchDetails.url = m_path;
-        dirFetchDetails.details = m_details;
-        dirFetchDetails.filters = QDir::NoDotAndDotDot;
-
-        if(reload) {
-            dirFetchDetails.openFlags = KDirListerV2::Reload;
-        }
+    // If the lister already has this folder (listed or still listing) we get that one, whatever it has so far
+    // comes in with directoryContentChanged and the rest follows as it's listed.
+    KDirListerV2::DirectoryFetchDetails dirFetchDetails;
+    dirFetchDetails.url = m_path;
+    dirFetchDetails.details = m_details;
+    dirFetchDetails.filters = QDir::NoDotAndDotDot;
 
-        m_lister.openUrl(dirFetchDetails);
-    } else {
-        slotCompleted(m_lister.directory(m_path));
+    if(reload) {
+        dirFetchDetails.openFlags = KDirListerV2::Reload;
     }
+
+    m_lister.openUrl(dirFetchDetails);
 }
 
 const QString &DirListModel::path()
@@ -82,6 +84,11 @@ void DirListModel::setDetails(const QString &details)
 {
     if(m_details != details) {
         m_details = details;
+
+        // The folder we show fills in the details it doesn't have yet, no need to reload.
+        if(m_dir) {
+            m_dir->setDetails(details);
+        }
         emit detailsChanged();
     }
 }
@@ -114,19 +121,19 @@ QVariant DirListModel::data(const QModelIndex &index, int role) const
     return m_emptyVariant;
 }
 
-QVariant DirListModel::data(int index, int role) const
+QVariant DirListModel::data(int index, int role, bool requestDetails) const
 {
-    const KDirectoryEntry& entry = m_dir->entry(index);
+    const KDirectoryEntry entry = m_dir->entry(index);
 
     switch (role) {
     case Name:
-        return QVariant(entry.name());
+        return entry.nameVariant();
         break;
     case BaseName:
-        return QVariant(entry.basename());
+        return entry.basenameVariant();
         break;
     case Extension:
-        return QVariant(entry.extension());
+        return entry.extensionVariant();
         break;
     case Hidden:
         return QVariant(entry.isHidden());
@@ -142,27 +149,27 @@ QVariant DirListModel::data(int index, int role) const
         return QVariant("TO_BE_IMPLEMENTED");
         break;
     case Size:
-        if(!entry.detailsLoaded()) m_dir->loadEntryDetails(index);
+        if(requestDetails && !entry.detailsLoaded()) m_dir->loadEntryDetails(index);
         return QVariant(entry.size());
         break;
     case ModificationTime:
-        if(!entry.detailsLoaded()) m_dir->loadEntryDetails(index);
+        if(requestDetails && !entry.detailsLoaded()) m_dir->loadEntryDetails(index);
         return QVariant(entry.time(KDirectoryEntry::ModificationTime));
         break;
     case AccessTime:
-        if(!entry.detailsLoaded()) m_dir->loadEntryDetails(index);
+        if(requestDetails && !entry.detailsLoaded()) m_dir->loadEntryDetails(index);
         return QVariant(entry.time(KDirectoryEntry::AccessTime));
         break;
     case CreationTime:
-        if(!entry.detailsLoaded()) m_dir->loadEntryDetails(index);
+        if(requestDetails && !entry.detailsLoaded()) m_dir->loadEntryDetails(index);
         return QVariant(entry.time(KDirectoryEntry::CreationTime));
         break;
     case User:
-        if(!entry.detailsLoaded()) m_dir->loadEntryDetails(index);
+        if(requestDetails && !entry.detailsLoaded()) m_dir->loadEntryDetails(index);
         return QVariant(entry.user());
         break;
     case Group:
-        if(!entry.detailsLoaded()) m_dir->loadEntryDetails(index);
+        if(requestDetails && !entry.detailsLoaded()) m_dir->loadEntryDetails(index);
         return QVariant(entry.group());
         break;
     default:
@@ -170,6 +177,120 @@ QVariant DirListModel::data(int index, int role) const
     }
 }
 
+int DirListModel::dictionaryColumn(int role)
+{
+    switch (role) {
+    case Extension:
+        return KDirectoryEntryStore::ExtensionColumn;
+    case MimeComment:
+        return KDirectoryEntryStore::MimeCommentColumn;
+    case MimeIcon:
+        return KDirectoryEntryStore::IconNameColumn;
+    case User:
+        return KDirectoryEntryStore::UserColumn;
+    case Group:
+        return KDirectoryEntryStore::GroupColumn;
+    default:
+        return -1;
+    }
+}
+
+int DirListModel::dictionaryCode(int index, int role, bool requestDetails) const
+{
+    const int column = dictionaryColumn(role);
+    if(!m_dir || column < 0 || index < 0 || index >= m_dir->count()) {
+        return -1;
+    }
+
+    // User and group are only known once the details are loaded. Until then they have the code of the empty string.
+    const int id = m_dir->entryIndex(index);
+    if(requestDetails && (role == User || role == Group) && !m_dir->entries().detailsLoaded(id)) {
+        m_dir->loadEntryDetails(index);
+    }
+
+    return m_dir->entries().code(id, static_cast<KDirectoryEntryStore::DictionaryColumn>(column));
+}
+
+int DirListModel::dictionaryCodeForValue(int role, const QString &value) const
+{
+    const int column = dictionaryColumn(role);
+    if(!m_dir || column < 0) {
+        return -1;
+    }
+    return m_dir->entries().dictionary(static_cast<KDirectoryEntryStore::DictionaryColumn>(column)).code(value);
+}
+
+QVector<int> DirListModel::dictionaryRanks(int role) const
+{
+    const int column = dictionaryColumn(role);
+    if(!m_dir || column < 0) {
+        return QVector<int>();
+    }
+    return m_dir->entries().dictionary(static_cast<KDirectoryEntryStore::DictionaryColumn>(column)).ranks();
+}
+
+QStringRef DirListModel::stringRef(int index, int role) const
+{
+    if(!m_dir) {
+        return QStringRef();
+    }
+
+    const KDirectoryEntry entry = m_dir->entry(index);
+    switch (role) {
+    case Name:
+        return entry.nameRef();
+    case BaseName:
+        return entry.basenameRef();
+    case Extension:
+        return entry.extensionRef();
+    default:
+        return QStringRef();
+    }
+}
+
+bool DirListModel::isNumericRole(int role)
+{
+    return role == Size || role == ModificationTime || role == AccessTime || role == CreationTime;
+}
+
+qint64 DirListModel::numericValue(int index, int role, bool requestDetails) const
+{
+    if(!m_dir || !isNumericRole(role) || index < 0 || index >= m_dir->count()) {
+        return -1;
+    }
+
+    const KDirectoryEntryStore& entries = m_dir->entries();
+    const int id = m_dir->entryIndex(index);
+    if(!entries.detailsLoaded(id)) {
+        if(requestDetails) {
+            m_dir->loadEntryDetails(index);
+        }
+        return -1;
+    }
+
+    switch (role) {
+    case Size:
+        return entries.size(id);
+    case ModificationTime:
+        return entries.timestamp(id, KDirectoryEntry::ModificationTime);
+    case AccessTime:
+        return entries.timestamp(id, KDirectoryEntry::AccessTime);
+    case CreationTime:
+        return entries.timestamp(id, KDirectoryEntry::CreationTime);
+    default:
+        return -1;
+    }
+}
+
+QString DirListModel::dictionaryValue(int role, int code) const
+{
+    const int column = dictionaryColumn(role);
+    if(!m_dir || column < 0 || code < 0) {
+        return QString();
+    }
+    return m_dir->entries().dictionary(static_cast<KDirectoryEntryStore::DictionaryColumn>(column)).value(code);
+}
+
 int DirListModel::rowCount(const QModelIndex &) const
 {
     if(m_dir) {
@@ -245,22 +366,38 @@ QVariant DirListModel::headerName(int role) const
 
 void DirListModel::reload()
 {
-    beginRemoveRows(QModelIndex(), 0, m_currentRowCount);
-    m_currentRowCount = 0;
-    endRemoveRows();
+    // The rows stay. Once the folder is listed again only the rows that changed are inserted, removed or updated.
     setPath(m_path, true);
 }
 
+void DirListModel::releaseDirectory()
+{
+    if(m_dir) {
+        disconnect(m_dir, 0, this, 0);
+        KDirectory* dir = m_dir;
+        m_dir = 0;
+        dir->deref();
+    }
+}
+
+void DirListModel::setVisibleRange(int first, int last)
+{
+    if(m_dir) {
+        m_dir->setVisibleRange(first, last);
+    }
+}
+
 void DirListModel::slotDirectoryContentChanged(KDirectory *dir)
 {
     if((!m_dir && dir) || dir != m_dir) {
+        releaseDirectory();
         m_dir = dir;
-        connect(m_dir, &KDirectory::entryDetailsChanged, [&](KDirectory*, int id){
-            // notify the view that the entry with "id" has changed data.
-            QModelIndex topLeft = createIndex(id, 0);
-            QModelIndex bottomRight = createIndex(id, m_roleCount - 1); // WHY -1? I have to do this if i hook it in a proxy. Why, i don't know.
-            emit dataChanged(topLeft, bottomRight);
-        });
+        m_dir->ref();
+        connect(m_dir, &KDirectory::entriesAdded, this, &DirListModel::slotEntriesAdded);
+        connect(m_dir, &KDirectory::entriesRemoved, this, &DirListModel::slotEntriesRemoved);
+        connect(m_dir, &KDirectory::entriesChanged, this, &DirListModel::slotEntriesChanged);
+        // Loaded details are just changed data for the view, one dataChanged per range.
+        connect(m_dir, &KDirectory::entriesDetailsChanged, this, &DirListModel::slotEntriesChanged);
     }
 
     if(m_currentRowCount < m_dir->count()) {
@@ -273,9 +410,49 @@ void DirListModel::slotDirectoryContentChanged(KDirectory *dir)
 
 void DirListModel::slotCompleted(KDirectory *dir)
 {
-    // If we have remaining entries in this last signal we need to process them.
-    if(dir->count() > m_currentRowCount) {
-        slotDirectoryContentChanged(dir);
-    }
+    // If we have remaining entries in this last signal we need to process them. An empty folder never sent
+    // directoryContentChanged, it still has to be adopted here to get the entriesAdded of later (KDirWatch) changes.
+    slotDirectoryContentChanged(dir);
     m_doneLoading = true;
 }
+
+void DirListModel::slotEntriesAdded(KDirectory *dir, const KDirectoryRanges &ranges)
+{
+    if(dir != m_dir) {
+        return;
+    }
+
+    // The ranges are the final positions in ascending order. Inserting them in that order puts every row
+    // where it belongs since everything before it is already in place.
+    for(const KDirectoryRange& range : ranges) {
+        beginInsertRows(QModelIndex(), range.first, range.last);
+        m_currentRowCount += range.count();
+        endInsertRows();
+    }
+}
+
+void DirListModel::slotEntriesRemoved(KDirectory *dir, const KDirectoryRanges &ranges)
+{
+    if(dir != m_dir) {
+        return;
+    }
+
+    // Last range first, that keeps the row numbers of the ranges before it valid.
+    for(int i = ranges.count() - 1; i >= 0; i--) {
+        const KDirectoryRange& range = ranges.at(i);
+        beginRemoveRows(QModelIndex(), range.first, range.last);
+        m_currentRowCount -= range.count();
+        endRemoveRows();
+    }
+}
+
+void DirListModel::slotEntriesChanged(KDirectory *dir, const KDirectoryRanges &ranges)
+{
+    if(dir != m_dir) {
+        return;
+    }
+
+    for(const KDirectoryRange& range : ranges) {
+        emit dataChanged(createIndex(range.first, 0), createIndex(range.last, m_roleCount - 1));
+    }
+}
@@ -68,8 +68,65 @@ public:
     /*
      * This function is used to access the data without the need of making a QModelIndex.
      * This is helpfull when using data in a sort function.
+     * Missing details are requested, unless @p requestDetails is false. Pass false when calling this
+     * from another thread then the GUI thread, the same goes for numericValue and dictionaryCode.
      */
-    QVariant data(int index, int role = Qt::DisplayRole) const;
+    QVariant data(int index, int role = Qt::DisplayRole, bool requestDetails = true) const;
+
+    /**
+     * Returns a non owning view on the string for @p role of the entry at @p index.
+     * Only works for Name, BaseName and Extension, all other roles return an empty QStringRef.
+     * Use this in comparators where data() would allocate a QString (and a QVariant) per call.
+     * @return QStringRef
+     */
+    QStringRef stringRef(int index, int role) const;
+
+    /**
+     * Returns true if @p role is a number in the entry store (Size and the times).
+     * Those roles can be sorted and grouped with numericValue.
+     * @return bool
+     */
+    static bool isNumericRole(int role);
+
+    /**
+     * Returns the raw number for @p role of the entry at @p index: the size in bytes or the time
+     * in seconds since epoch. Unlike data() this doesn't create a QDateTime or QVariant.
+     * @return qint64 the value, -1 if unknown or @p role isn't numeric.
+     */
+    qint64 numericValue(int index, int role, bool requestDetails = true) const;
+
+    /**
+     * Returns the KDirectoryEntryStore::DictionaryColumn that backs @p role or -1 if the
+     * role isn't dictionary encoded. Roles that are dictionary encoded can be grouped and
+     * sorted on integers instead of strings (see dictionaryCode and dictionaryRanks).
+     * @return int column or -1
+     */
+    static int dictionaryColumn(int role);
+
+    /**
+     * Returns the dictionary code of @p role for the entry at @p index. Equal codes mean equal values.
+     * @return int code or -1 if @p role isn't dictionary encoded.
+     */
+    int dictionaryCode(int index, int role, bool requestDetails = true) const;
+
+    /**
+     * Returns the dictionary code for the string @p value of @p role.
+     * @return int code or -1 if the value (or role) is unknown.
+     */
+    int dictionaryCodeForValue(int role, const QString& value) const;
+
+    /**
+     * Returns the rank per dictionary code for @p role. ranks[dictionaryCode(a)] < ranks[dictionaryCode(b)]
+     * gives the same result as comparing the string values of a and b.
+     * @return QVector<int> (a copy, so it can be used from another thread)
+     */
+    QVector<int> dictionaryRanks(int role) const;
+
+    /**
+     * Returns the string value for dictionary @p code of @p role.
+     * @return QString
+     */
+    QString dictionaryValue(int role, int code) const;
 
     /// Reimplemented from QAbstractItemModel.
     virtual int rowCount(const QModelIndex & parent = QModelIndex()) const;
@@ -79,8 +136,17 @@ public:
 
     void reload();
 
+    /**
+     * Call this from the view when it scrolls. Details are loaded for the visible rows first,
+     * rows that scrolled by before their details where loaded are skipped.
+     */
+    Q_INVOKABLE void setVisibleRange(int first, int last);
+
     void slotDirectoryContentChanged(KDirectory* dir);
     void slotCompleted(KDirectory* dir);
+    void slotEntriesAdded(KDirectory* dir, const KDirectoryRanges& ranges);
+    void slotEntriesRemoved(KDirectory* dir, const KDirectoryRanges& ranges);
+    void slotEntriesChanged(KDirectory* dir, const KDirectoryRanges& ranges);
 
     friend class DirGroupedProxyModel;
     friend class DirGroupedModel;
@@ -93,6 +159,8 @@ signals:
     void detailsChanged();
 
 private:
+    void releaseDirectory();
+
     KDirListerV2 m_lister;
     KDirectory* m_dir;
     QVariant m_emptyVariant;
@@ -23,6 +23,7 @@
 #include <QElapsedTimer>
 #include <QDebug>
 #include <algorithm>
+#include <functional>
 #include <iostream>
 #include <valgrind/callgrind.h>
 
@@ -34,6 +35,9 @@ FlatDirGroupedSortModel::FlatDirGroupedSortModel(QObject *parent)
     , m_collator()
     , m_fromProxyToSource()
     , m_fromSourceToProxy()
+    , m_sortKeysRole(-1)
+    , m_rankKeys()
+    , m_numericKeys()
     , m_threadPool(2) // a thread pool with two threads waiting for your command.
 {
     // This makes sure sorting is done in a natural way. Aka, 1, 2, 3, ... 9, 10 instead of 1, 10, ...
@@ -48,7 +52,27 @@ FlatDirGroupedSortModel::FlatDirGroupedSortModel(QObject *parent)
     connect(sourceModel(), &QAbstractListModel::rowsRemoved, this, &FlatDirGroupedSortModel::modelRowsRemoved);
 
     connect(sourceModel(), &QAbstractListModel::dataChanged, [&](const QModelIndex &topLeft, const QModelIndex &bottomRight){
-        this->dataChanged(topLeft, bottomRight);
+        // Loaded details change the keys we sort on.
+        m_sortKeysRole = -1;
+
+        // Source rows that are next to each other can be anywhere in our (sorted) order. Map them, sort them and
+        // tell the view once per run of proxy rows that are next to each other.
+        const int lastColumn = bottomRight.column();
+        const int lastRow = qMin(bottomRight.row(), m_fromSourceToProxy.size() - 1);
+        QVector<int> proxyRows;
+        proxyRows.reserve(qMax(0, lastRow - topLeft.row() + 1));
+        for(int row = topLeft.row(); row <= lastRow; row++) {
+            proxyRows.append(m_fromSourceToProxy.at(row));
+        }
+        std::sort(proxyRows.begin(), proxyRows.end());
+
+        int first = 0;
+        for(int i = 1; i <= proxyRows.count(); i++) {
+            if(i == proxyRows.count() || proxyRows.at(i) != proxyRows.at(i - 1) + 1) {
+                this->dataChanged(createIndex(proxyRows.at(first), 0), createIndex(proxyRows.at(i - 1), lastColumn));
+                first = i;
+            }
+        }
     });
 
     connect(sourceModel(), &QAbstractListModel::layoutAboutToBeChanged, [&](){
@@ -87,6 +111,13 @@ void FlatDirGroupedSortModel::setGroupby(int role)
 
 void FlatDirGroupedSortModel::sort(int column, Qt::SortOrder order)
 {
+    // Dictionary encoded roles are sorted on their rank. That's an int compare instead of a QVariant string compare.
+    // Size and times are sorted on the raw numbers from the entry store, no QDateTime or QVariant is created.
+    QVector<int> keys;
+    const bool useRankKeys = fillRankKeys(column, 0, m_fromProxyToSource.size() - 1, keys);
+    QVector<qint64> numericKeys;
+    const bool useNumericKeys = !useRankKeys && fillNumericKeys(column, 0, m_fromProxyToSource.size() - 1, numericKeys);
+
     // Actual sort the list we just composed. This just prepares the proxy id's in the right order.
     if(order == Qt::AscendingOrder) {
         if(column == DirListModel::Name) {
@@ -94,6 +125,19 @@ void FlatDirGroupedSortModel::sort(int column, Qt::SortOrder order)
             std::sort(m_fromProxyToSource.begin(), m_fromProxyToSource.end(), [&](int a, int b) {
                 return m_collator.compare(m_listModel->data(a, DirListModel::Name).toString(), m_listModel->data(b, DirListModel::Name).toString()) < 0;
             });
+        } else if(useRankKeys) {
+            std::sort(m_fromProxyToSource.begin(), m_fromProxyToSource.end(), [&](int a, int b) {
+                return keys.at(a) < keys.at(b);
+            });
+        } else if(useNumericKeys) {
+            std::sort(m_fromProxyToSource.begin(), m_fromProxyToSource.end(), [&](int a, int b) {
+                return numericKeys.at(a) < numericKeys.at(b);
+            });
+        } else if(column == DirListModel::BaseName) {
+            // Compare the views on the name storage, no strings are being created.
+            std::sort(m_fromProxyToSource.begin(), m_fromProxyToSource.end(), [&](int a, int b) {
+                return QStringRef::compare(m_listModel->stringRef(a, column), m_listModel->stringRef(b, column)) < 0;
+            });
         } else {
             std::sort(m_fromProxyToSource.begin(), m_fromProxyToSource.end(), [&](int a, int b) {
                 return variantLessThan(m_listModel->data(a, column), m_listModel->data(b, column));
@@ -105,6 +149,18 @@ void FlatDirGroupedSortModel::sort(int column, Qt::SortOrder order)
             std::sort(m_fromProxyToSource.begin(), m_fromProxyToSource.end(), [&](int a, int b) {
                 return m_collator.compare(m_listModel->data(b, DirListModel::Name).toString(), m_listModel->data(a, DirListModel::Name).toString()) < 0;
             });
+        } else if(useRankKeys) {
+            std::sort(m_fromProxyToSource.begin(), m_fromProxyToSource.end(), [&](int a, int b) {
+                return keys.at(b) < keys.at(a);
+            });
+        } else if(useNumericKeys) {
+            std::sort(m_fromProxyToSource.begin(), m_fromProxyToSource.end(), [&](int a, int b) {
+                return numericKeys.at(b) < numericKeys.at(a);
+            });
+        } else if(column == DirListModel::BaseName) {
+            std::sort(m_fromProxyToSource.begin(), m_fromProxyToSource.end(), [&](int a, int b) {
+                return QStringRef::compare(m_listModel->stringRef(b, column), m_listModel->stringRef(a, column)) < 0;
+            });
         } else {
             std::sort(m_fromProxyToSource.begin(), m_fromProxyToSource.end(), [&](int a, int b) {
                 return variantLessThan(m_listModel->data(b, column), m_listModel->data(a, column));
@@ -125,10 +181,14 @@ void FlatDirGroupedSortModel::sort(int column, Qt::SortOrder order)
 void FlatDirGroupedSortModel::sortGroup(int column, const QString &groupValue, Qt::SortOrder order)
 {
     std::cout << "Main thread id: " << std::this_thread::get_id() << std::endl;
-    m_threadPool.enqueue(&FlatDirGroupedSortModel::sortGroup_Thread, this, column, groupValue, order);
+
+    // The keys are made here, once for all groups that are sorted on the same column. Asking for missing
+    // details only works from the GUI thread. The thread gets a (shallow) copy, we detach when we fill them again.
+    fillSortKeys(column);
+    m_threadPool.enqueue(&FlatDirGroupedSortModel::sortGroup_Thread, this, column, groupValue, order, m_rankKeys, m_numericKeys);
 }
 
-void FlatDirGroupedSortModel::sortGroup_Thread(int column, const QString &groupValue, Qt::SortOrder order)
+void FlatDirGroupedSortModel::sortGroup_Thread(int column, const QString &groupValue, Qt::SortOrder order, const QVector<int> &keys, const QVector<qint64> &numericKeys)
 {
     std::cout << "Worker thread id: " << std::this_thread::get_id() << std::endl;
     QElapsedTimer t;
@@ -143,11 +203,22 @@ void FlatDirGroupedSortModel::sortGroup_Thread(int column, const QString &groupV
     // We use m_fromProxyToSource instead of m_fromSourceToProxy for one reason. In the sort functions below we need the source indexes.
     // If we would have used m_fromSourceToProxy then we would have to translate those proxy id's back to source id's. Which is easy and
     // fast, but this is probably (not tested) faster because i leave out the additional translation.
-    for(const int i : m_fromProxyToSource) {
-        const QString& groupByValue = m_listModel->data(i, m_groupby).toString();
-        if(groupByValue == groupValue) {
-            indexesInThisGroup.append(i);
-            proxyIndexesInThisGroup.append(m_fromSourceToProxy[i]);
+    if(DirListModel::dictionaryColumn(m_groupby) >= 0) {
+        // Dictionary encoded group: look up the code of the group once and compare codes from there on.
+        const int groupCode = m_listModel->dictionaryCodeForValue(m_groupby, groupValue);
+        for(const int i : m_fromProxyToSource) {
+            if(m_listModel->dictionaryCode(i, m_groupby, false) == groupCode) {
+                indexesInThisGroup.append(i);
+                proxyIndexesInThisGroup.append(m_fromSourceToProxy[i]);
+            }
+        }
+    } else {
+        for(const int i : m_fromProxyToSource) {
+            const QString& groupByValue = m_listModel->data(i, m_groupby, false).toString();
+            if(groupByValue == groupValue) {
+                indexesInThisGroup.append(i);
+                proxyIndexesInThisGroup.append(m_fromSourceToProxy[i]);
+            }
         }
     }
 
@@ -155,6 +226,10 @@ void FlatDirGroupedSortModel::sortGroup_Thread(int column, const QString &groupV
     // Then - once sorted - we can map the new id's back to the old id's and update the proxy <> source mapping.
     const QVector<int> oldIndexesInThisGroup = indexesInThisGroup;
 
+    // This thread only reads, the keys come from sortGroup. Everything else is read without asking for details.
+    const bool useRankKeys = !keys.isEmpty();
+    const bool useNumericKeys = !useRankKeys && !numericKeys.isEmpty();
+
     // Sort!
     if(order == Qt::AscendingOrder) {
         if(column == DirListModel::Name) {
@@ -163,9 +238,21 @@ void FlatDirGroupedSortModel::sortGroup_Thread(int column, const QString &groupV
                 return m_nameCache.at(a) < m_nameCache.at(b);
                 //return m_collator.compare(m_listModel->data(a, DirListModel::Name).toString(), m_listModel->data(b, DirListModel::Name).toString()) < 0;
             });
+        } else if(useRankKeys) {
+            std::sort(indexesInThisGroup.begin(), indexesInThisGroup.end(), [&](int a, int b) {
+                return keys.at(a) < keys.at(b);
+            });
+        } else if(useNumericKeys) {
+            std::sort(indexesInThisGroup.begin(), indexesInThisGroup.end(), [&](int a, int b) {
+                return numericKeys.at(a) < numericKeys.at(b);
+            });
+        } else if(column == DirListModel::BaseName) {
+            std::sort(indexesInThisGroup.begin(), indexesInThisGroup.end(), [&](int a, int b) {
+                return QStringRef::compare(m_listModel->stringRef(a, column), m_listModel->stringRef(b, column)) < 0;
+            });
         } else {
             std::sort(indexesInThisGroup.begin(), indexesInThisGroup.end(), [&](int a, int b) {
-                return variantLessThan(m_listModel->data(a, column), m_listModel->data(b, column));
+                return variantLessThan(m_listModel->data(a, column, false), m_listModel->data(b, column, false));
             });
         }
     } else {
@@ -175,9 +262,21 @@ void FlatDirGroupedSortModel::sortGroup_Thread(int column, const QString &groupV
                 return m_nameCache.at(b) < m_nameCache.at(a);
                 //return m_collator.compare(m_listModel->data(b, DirListModel::Name).toString(), m_listModel->data(a, DirListModel::Name).toString()) < 0;
             });
+        } else if(useRankKeys) {
+            std::sort(indexesInThisGroup.begin(), indexesInThisGroup.end(), [&](int a, int b) {
+                return keys.at(b) < keys.at(a);
+            });
+        } else if(useNumericKeys) {
+            std::sort(indexesInThisGroup.begin(), indexesInThisGroup.end(), [&](int a, int b) {
+                return numericKeys.at(b) < numericKeys.at(a);
+            });
+        } else if(column == DirListModel::BaseName) {
+            std::sort(indexesInThisGroup.begin(), indexesInThisGroup.end(), [&](int a, int b) {
+                return QStringRef::compare(m_listModel->stringRef(b, column), m_listModel->stringRef(a, column)) < 0;
+            });
         } else {
             std::sort(indexesInThisGroup.begin(), indexesInThisGroup.end(), [&](int a, int b) {
-                return variantLessThan(m_listModel->data(b, column), m_listModel->data(a, column));
+                return variantLessThan(m_listModel->data(b, column, false), m_listModel->data(a, column, false));
             });
         }
     }
@@ -211,7 +310,9 @@ QModelIndex FlatDirGroupedSortModel::parent(const QModelIndex &index) const
 
 int FlatDirGroupedSortModel::rowCount(const QModelIndex &) const
 {
-    return m_listModel->rowCount();
+    // Our own bookkeeping, not the source model. When source rows are removed the source is already
+    // smaller before we get to tell the view which of our rows are gone.
+    return m_fromProxyToSource.size();
 }
 
 int FlatDirGroupedSortModel::columnCount(const QModelIndex &parent) const
@@ -239,14 +340,29 @@ QModelIndex FlatDirGroupedSortModel::mapToSource(const QModelIndex &proxyIndex)
 
 void FlatDirGroupedSortModel::modelRowsInserted(const QModelIndex & parent, int start, int end)
 {
-    beginInsertRows(parent, start, end);
-
+    // New rows always go at the end of our order, even if the source inserted them in between (sorted listing).
+    const int proxyStart = m_fromProxyToSource.size();
+    const int numOfNewRows = end - start + 1;
+    beginInsertRows(parent, proxyStart, proxyStart + numOfNewRows - 1);
+    m_sortKeysRole = -1;
+
+    // Source rows from start on moved down.
+    for(int& sourceRow : m_fromProxyToSource) {
+        if(sourceRow >= start) {
+            sourceRow += numOfNewRows;
+        }
+    }
 
     // We first simply add the new entries to our bookkeeping vectors. Ordering them will happen later.
     for(int i = start; i <= end; i++) {
         m_fromProxyToSource.append(i);
-        m_fromSourceToProxy.append(i);
-        m_nameCache.append(m_collator.sortKey(m_listModel->data(i, DirListModel::Name).toString()));
+        m_nameCache.insert(i, m_collator.sortKey(m_listModel->data(i, DirListModel::Name).toString()));
+    }
+
+    const int numOfRows = m_fromProxyToSource.size();
+    m_fromSourceToProxy.resize(numOfRows);
+    for(int proxyRow = 0; proxyRow < numOfRows; proxyRow++) {
+        m_fromSourceToProxy[m_fromProxyToSource.at(proxyRow)] = proxyRow;
     }
 
     // As soon as we insert new rows, we remove the cache to know which items we have sorted.
@@ -254,7 +370,7 @@ void FlatDirGroupedSortModel::modelRowsInserted(const QModelIndex & parent, int
     m_sortedProxyIds.fill(false);
 
     if(m_groupby != DirListModel::None) {
-        orderNewEntries(start, end);
+        orderNewEntries(start, end, proxyStart);
     }
 
     endInsertRows();
@@ -262,47 +378,175 @@ void FlatDirGroupedSortModel::modelRowsInserted(const QModelIndex & parent, int
 
 void FlatDirGroupedSortModel::modelRowsRemoved(const QModelIndex & parent, int start, int end)
 {
-    beginRemoveRows(parent, start, end);
+    end = qMin(end, m_fromSourceToProxy.size() - 1);
+    if(start > end) {
+        return;
+    }
+    m_sortKeysRole = -1;
 
-    // This is OBVIOUSLY wrong! It should be removing those that should actually be removed...
-    // This will do as a temporary workaround :)
-    m_fromProxyToSource.clear();
-    m_fromSourceToProxy.clear();
-    m_itemsPerGroup.clear();
-    m_nameCache.clear();
-    m_sortedProxyIds.fill(false);
+    // The source rows start till end can be anywhere in our order. Collect the proxy rows they map to, highest first,
+    // so that removing one run of rows doesn't change the row numbers of the runs still to come.
+    QVector<int> proxyRows;
+    for(int i = start; i <= end; i++) {
+        proxyRows.append(m_fromSourceToProxy.at(i));
+    }
+    std::sort(proxyRows.begin(), proxyRows.end(), std::greater<int>());
+
+    const int numOfProxyRows = proxyRows.size();
+    int i = 0;
+    while(i < numOfProxyRows) {
+        const int last = proxyRows.at(i);
+        int first = last;
+        while(i + 1 < numOfProxyRows && proxyRows.at(i + 1) == first - 1) {
+            first--;
+            i++;
+        }
+        i++;
+
+        beginRemoveRows(parent, first, last);
+        m_fromProxyToSource.remove(first, last - first + 1);
+        if(last < m_sortedProxyIds.size()) {
+            m_sortedProxyIds.remove(first, last - first + 1);
+        }
+        endRemoveRows();
+    }
+
+    // Source rows after the removed ones moved up.
+    const int numRemoved = end - start + 1;
+    for(int& sourceRow : m_fromProxyToSource) {
+        if(sourceRow > end) {
+            sourceRow -= numRemoved;
+        }
+    }
+
+    const int numOfRows = m_fromProxyToSource.size();
+    m_fromSourceToProxy.resize(numOfRows);
+    for(int proxyRow = 0; proxyRow < numOfRows; proxyRow++) {
+        m_fromSourceToProxy[m_fromProxyToSource.at(proxyRow)] = proxyRow;
+    }
 
-    endRemoveRows();
+    if(end < m_nameCache.size()) {
+        m_nameCache.erase(m_nameCache.begin() + start, m_nameCache.begin() + end + 1);
+    }
+
+    recountGroups();
 }
 
-void FlatDirGroupedSortModel::orderNewEntries(int start, int end)
+void FlatDirGroupedSortModel::orderNewEntries(int start, int end, int proxyStart)
 {
+    // Unless told otherwise the new source rows are at the same proxy rows.
+    if(proxyStart < 0) {
+        proxyStart = start;
+    }
+
     // Create a temporary vector containing our new indexes.
     QVector<int> newEntries;
     for(int i = start; i <= end; i++) {
         newEntries.append(i);
     }
 
-    // Sort based on grouping key
-    std::sort(newEntries.begin(), newEntries.end(), [&](int a, int b) {
-        return m_listModel->data(a, m_groupby).toString().compare(m_listModel->data(b, m_groupby).toString()) < 0;
-    });
+    // Sort based on grouping key. Dictionary encoded roles use the dictionary rank so that we don't compare strings.
+    QVector<int> keys;
+    const bool useRankKeys = fillRankKeys(m_groupby, start, end, keys);
+    QVector<qint64> numericKeys;
+    const bool useNumericKeys = !useRankKeys && fillNumericKeys(m_groupby, start, end, numericKeys);
+    if(useRankKeys) {
+        std::sort(newEntries.begin(), newEntries.end(), [&](int a, int b) {
+            return keys.at(a) < keys.at(b);
+        });
+    } else if(useNumericKeys) {
+        std::sort(newEntries.begin(), newEntries.end(), [&](int a, int b) {
+            return numericKeys.at(a) < numericKeys.at(b);
+        });
+    } else if(m_groupby == DirListModel::Name || m_groupby == DirListModel::BaseName) {
+        std::sort(newEntries.begin(), newEntries.end(), [&](int a, int b) {
+            return QStringRef::compare(m_listModel->stringRef(a, m_groupby), m_listModel->stringRef(b, m_groupby)) < 0;
+        });
+    } else {
+        std::sort(newEntries.begin(), newEntries.end(), [&](int a, int b) {
+            return m_listModel->data(a, m_groupby).toString().compare(m_listModel->data(b, m_groupby).toString()) < 0;
+        });
+    }
 
     // Update our bookkeeping vectors
     const int newSize = newEntries.size();
     for(int i = 0; i < newSize; i++) {
         // New proxy to source index becomes:
-        m_fromProxyToSource[i + start] = newEntries[i];
+        m_fromProxyToSource[i + proxyStart] = newEntries[i];
 
         // New source to proxy index becomes:
-        m_fromSourceToProxy[newEntries[i]] = i + start;
+        m_fromSourceToProxy[newEntries[i]] = i + proxyStart;
+    }
 
-        const QString& groupVal = m_listModel->data(i + start, m_groupby).toString();
-        if(m_itemsPerGroup.contains(groupVal)) {
-            const int curCount = m_itemsPerGroup.value(groupVal) + 1;
-            m_itemsPerGroup.insert(groupVal, curCount);
-        } else {
-            m_itemsPerGroup.insert(groupVal, 1);
+    // Count the items per group.
+    if(useRankKeys) {
+        // First count per dictionary code, then only touch the (string keyed) group hash once per distinct code.
+        QVector<int> itemsPerCode;
+        for(const int i : newEntries) {
+            const int code = m_listModel->dictionaryCode(i, m_groupby);
+            while(itemsPerCode.size() <= code) {
+                itemsPerCode.append(0);
+            }
+            itemsPerCode[code]++;
+        }
+
+        const int numOfCodes = itemsPerCode.size();
+        for(int code = 0; code < numOfCodes; code++) {
+            if(itemsPerCode.at(code) > 0) {
+                m_itemsPerGroup[m_listModel->dictionaryValue(m_groupby, code)] += itemsPerCode.at(code);
+            }
+        }
+    } else if(useNumericKeys) {
+        // The entries are sorted on their number now, so equal values are next to each other. Only the
+        // first entry of every run of equal values is needed to get the (string) group name.
+        const int numOfEntries = newEntries.size();
+        int runStart = 0;
+        for(int i = 1; i <= numOfEntries; i++) {
+            if(i == numOfEntries || numericKeys.at(newEntries.at(i)) != numericKeys.at(newEntries.at(runStart))) {
+                m_itemsPerGroup[m_listModel->data(newEntries.at(runStart), m_groupby).toString()] += i - runStart;
+                runStart = i;
+            }
+        }
+    } else {
+        for(const int i : newEntries) {
+            const QString& groupVal = m_listModel->data(i, m_groupby).toString();
+            if(m_itemsPerGroup.contains(groupVal)) {
+                const int curCount = m_itemsPerGroup.value(groupVal) + 1;
+                m_itemsPerGroup.insert(groupVal, curCount);
+            } else {
+                m_itemsPerGroup.insert(groupVal, 1);
+            }
+        }
+    }
+}
+
+void FlatDirGroupedSortModel::recountGroups()
+{
+    m_itemsPerGroup.clear();
+    if(m_groupby == DirListModel::None) {
+        return;
+    }
+
+    if(DirListModel::dictionaryColumn(m_groupby) >= 0) {
+        // Count per dictionary code, then only touch the (string keyed) group hash once per distinct code.
+        QVector<int> itemsPerCode;
+        for(const int i : m_fromProxyToSource) {
+            const int code = m_listModel->dictionaryCode(i, m_groupby);
+            while(itemsPerCode.size() <= code) {
+                itemsPerCode.append(0);
+            }
+            itemsPerCode[code]++;
+        }
+
+        const int numOfCodes = itemsPerCode.size();
+        for(int code = 0; code < numOfCodes; code++) {
+            if(itemsPerCode.at(code) > 0) {
+                m_itemsPerGroup[m_listModel->dictionaryValue(m_groupby, code)] += itemsPerCode.at(code);
+            }
+        }
+    } else {
+        for(const int i : m_fromProxyToSource) {
+            m_itemsPerGroup[m_listModel->data(i, m_groupby).toString()]++;
         }
     }
 }
@@ -424,6 +668,51 @@ QString FlatDirGroupedSortModel::stringRole(int role)
     return roleNames().value(role);
 }
 
+bool FlatDirGroupedSortModel::fillRankKeys(int role, int start, int end, QVector<int> &keys)
+{
+    if(DirListModel::dictionaryColumn(role) < 0 || end < start) {
+        return false;
+    }
+
+    // keys is indexed by source row. Only the rows from start till end (inclusive) get a valid key.
+    const QVector<int> ranks = m_listModel->dictionaryRanks(role);
+    keys.resize(end + 1);
+    for(int i = start; i <= end; i++) {
+        keys[i] = ranks.value(m_listModel->dictionaryCode(i, role));
+    }
+    return true;
+}
+
+bool FlatDirGroupedSortModel::fillNumericKeys(int role, int start, int end, QVector<qint64> &keys)
+{
+    if(!DirListModel::isNumericRole(role) || end < start) {
+        return false;
+    }
+
+    // Same layout as fillRankKeys: indexed by source row, only start till end (inclusive) is filled in.
+    keys.resize(end + 1);
+    for(int i = start; i <= end; i++) {
+        keys[i] = m_listModel->numericValue(i, role);
+    }
+    return true;
+}
+
+void FlatDirGroupedSortModel::fillSortKeys(int role)
+{
+    // Still valid from the previous group? The keys are indexed by source row, any change in the rows or their data
+    // resets m_sortKeysRole.
+    if(role == m_sortKeysRole) {
+        return;
+    }
+
+    m_rankKeys.clear();
+    m_numericKeys.clear();
+    if(!fillRankKeys(role, 0, m_fromProxyToSource.size() - 1, m_rankKeys)) {
+        fillNumericKeys(role, 0, m_fromProxyToSource.size() - 1, m_numericKeys);
+    }
+    m_sortKeysRole = role;
+}
+
 bool FlatDirGroupedSortModel::variantLessThan(const QVariant &l, const QVariant &r)
 {
     switch (l.userType()) {
@@ -49,7 +49,7 @@ public:
 
     Q_INVOKABLE void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
     Q_INVOKABLE void sortGroup(int column, const QString& groupValue, Qt::SortOrder order = Qt::AscendingOrder);
-    void sortGroup_Thread(int column, const QString& groupValue, Qt::SortOrder order = Qt::AscendingOrder);
+    void sortGroup_Thread(int column, const QString& groupValue, Qt::SortOrder order, const QVector<int>& keys, const QVector<qint64>& numericKeys);
 
     virtual QModelIndex index(int row, int column, const QModelIndex & parent = QModelIndex()) const;
     virtual QModelIndex parent(const QModelIndex & index) const;
@@ -63,7 +63,8 @@ public:
     void modelRowsInserted(const QModelIndex &, int, int);
     void modelRowsRemoved(const QModelIndex &, int, int);
 
-    void orderNewEntries(int start, int end);
+    void orderNewEntries(int start, int end, int proxyStart = -1);
+    void recountGroups();
     void regroup();
 
     Q_INVOKABLE void reload();
@@ -72,6 +73,9 @@ public:
     Q_INVOKABLE QString stringRole(int role);
 
     inline bool variantLessThan(const QVariant& l, const QVariant& r);
+    bool fillRankKeys(int role, int start, int end, QVector<int>& keys);
+    bool fillNumericKeys(int role, int start, int end, QVector<qint64>& keys);
+    void fillSortKeys(int role);
 
 signals:
     void pathChanged();
@@ -91,6 +95,12 @@ private:
 
     QHash<QString, int> m_itemsPerGroup;
 
+    // Rank or numeric keys (indexed by source row) of m_sortKeysRole, -1 if they need to be filled again.
+    // Filled on the GUI thread, read by sortGroup_Thread.
+    int m_sortKeysRole;
+    QVector<int> m_rankKeys;
+    QVector<qint64> m_numericKeys;
+
     ThreadPool m_threadPool;
 };
 
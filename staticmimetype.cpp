@@ -19,15 +19,10 @@
 
 #include "staticmimetype.h"
 
-#include <QMimeDatabase>
-#include <QMimeType>
-
-StaticMimeType::StaticMimeType(const QString &name)
+StaticMimeType::StaticMimeType(const QMimeType &mime)
 {
-    QMimeDatabase db;
-    QMimeType mime = db.mimeTypeForFile(name, QMimeDatabase::MatchExtension);
-
     if(mime.isValid()) {
+        name = mime.name();
         iconName = mime.iconName();
         comment = mime.comment();
     }
@@ -24,11 +24,16 @@
 #include <QString>
 #include <QMimeType>
 
+/**
+ * The few bits of a QMimeType that we need, in a form that can be copied around and
+ * read from any thread. See KMimeTypeRegistry for how these are shared.
+ */
 class StaticMimeType
 {
 public:
     explicit StaticMimeType(){}
-    explicit StaticMimeType(const QString& name);
+    explicit StaticMimeType(const QMimeType& mime);
+    QString name;
     QString iconName;
     QString comment;
 };
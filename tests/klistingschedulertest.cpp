@@ -0,0 +1,157 @@
+/*
+    Copyright (C) 2013 Mark Gaiser <markg85@gmail.com>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "klistingscheduler.h"
+#include "kdirectory.h"
+
+#include <QStringList>
+#include <QTest>
+
+namespace {
+    // Records what the scheduler asks for instead of listing anything. Listings only end when the test says so.
+    class FakeBackend : public KListingScheduler::Backend
+    {
+    public:
+        void start(KDirectory* dir) { log << QStringLiteral("start ") + dir->url(); }
+        void suspend(KDirectory* dir) { log << QStringLiteral("suspend ") + dir->url(); }
+        void resume(KDirectory* dir) { log << QStringLiteral("resume ") + dir->url(); }
+
+        QStringList log;
+    };
+}
+
+class KListingSchedulerTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void cleanup();
+
+    void foregroundPreemptsBackground();
+    void fifoWithinPriority();
+    void raisePriorityOfWaitingJob();
+    void resumeAfterFinished();
+
+private:
+    KDirectory* directory(const QString& name);
+
+    KListingScheduler* m_scheduler;
+    FakeBackend* m_backend;
+    QObject* m_directories;
+};
+
+void KListingSchedulerTest::init()
+{
+    // One listing at a time makes every decision of the scheduler visible in the log.
+    m_scheduler = new KListingScheduler();
+    m_backend = new FakeBackend();
+    m_scheduler->setBackend(m_backend);
+    m_scheduler->setMaxConcurrency(QStringLiteral("fake"), 1);
+    m_directories = new QObject();
+}
+
+void KListingSchedulerTest::cleanup()
+{
+    // The scheduler first, otherwise it dispatches the remaining jobs while the directories go away.
+    delete m_scheduler;
+    delete m_directories;
+}
+
+KDirectory *KListingSchedulerTest::directory(const QString &name)
+{
+    KDirectory* dir = new KDirectory(QStringLiteral("fake:/") + name, m_directories);
+    dir->setDeferredStart(true);
+    return dir;
+}
+
+void KListingSchedulerTest::foregroundPreemptsBackground()
+{
+    KDirectory* background = directory("background");
+    KDirectory* foreground = directory("foreground");
+
+    m_scheduler->schedule(background, KListingScheduler::Background);
+    m_scheduler->schedule(foreground, KListingScheduler::Foreground);
+
+    QCOMPARE(m_backend->log, QStringList() << "start fake:/background" << "suspend fake:/background" << "start fake:/foreground");
+    QCOMPARE(m_scheduler->runningCount("fake"), 1);
+    QCOMPARE(m_scheduler->waitingCount("fake"), 1);
+}
+
+void KListingSchedulerTest::fifoWithinPriority()
+{
+    KDirectory* first = directory("first");
+    KDirectory* second = directory("second");
+    KDirectory* third = directory("third");
+
+    m_scheduler->schedule(first, KListingScheduler::Prefetch);
+    m_scheduler->schedule(second, KListingScheduler::Prefetch);
+    m_scheduler->schedule(third, KListingScheduler::Prefetch);
+    QCOMPARE(m_backend->log, QStringList() << "start fake:/first");
+
+    m_scheduler->finished(first);
+    m_scheduler->finished(second);
+    QCOMPARE(m_backend->log, QStringList() << "start fake:/first" << "start fake:/second" << "start fake:/third");
+    QCOMPARE(m_scheduler->waitingCount("fake"), 0);
+}
+
+void KListingSchedulerTest::raisePriorityOfWaitingJob()
+{
+    KDirectory* running = directory("running");
+    KDirectory* older = directory("older");
+    KDirectory* raised = directory("raised");
+
+    m_scheduler->schedule(running, KListingScheduler::Foreground);
+    m_scheduler->schedule(older, KListingScheduler::Background);
+    m_scheduler->schedule(raised, KListingScheduler::Background);
+
+    // Not more important then the running one, so it just waits. But it goes before the job that was scheduled earlier.
+    m_scheduler->raisePriority(raised, KListingScheduler::Prefetch);
+    QCOMPARE(m_backend->log, QStringList() << "start fake:/running");
+
+    m_scheduler->finished(running);
+    QCOMPARE(m_backend->log, QStringList() << "start fake:/running" << "start fake:/raised");
+
+    // A lower priority is ignored.
+    m_scheduler->raisePriority(older, KListingScheduler::Background);
+    m_scheduler->finished(raised);
+    QCOMPARE(m_backend->log, QStringList() << "start fake:/running" << "start fake:/raised" << "start fake:/older");
+}
+
+void KListingSchedulerTest::resumeAfterFinished()
+{
+    KDirectory* background = directory("background");
+    KDirectory* foreground = directory("foreground");
+
+    m_scheduler->schedule(background, KListingScheduler::Background);
+    m_scheduler->schedule(foreground, KListingScheduler::Foreground);
+    m_backend->log.clear();
+
+    // The suspended listing continues where it was, it isn't started again.
+    m_scheduler->finished(foreground);
+    QCOMPARE(m_backend->log, QStringList() << "resume fake:/background");
+    QCOMPARE(m_scheduler->runningCount("fake"), 1);
+    QCOMPARE(m_scheduler->waitingCount("fake"), 0);
+
+    m_scheduler->finished(background);
+    QCOMPARE(m_scheduler->runningCount("fake"), 0);
+}
+
+QTEST_GUILESS_MAIN(KListingSchedulerTest)
+
+#include "klistingschedulertest.moc"